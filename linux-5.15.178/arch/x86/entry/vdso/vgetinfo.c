@@ -6,34 +6,67 @@
 // #define CS_BASES 2
 #include <vdso/datapage.h>
 #include <asm/vvar.h>
+#include <asm/segment.h>
+#include <asm/barrier.h>
+#include <asm/msr.h>
+#include <asm/vdso/gettimeofday.h>
+#include <linux/math64.h>
 
 
-// vvar 区域大小，通常为 4 * PAGE_SIZE
-#define VVAR_SIZE   (4 * PAGE_SIZE)
-#define VTASK_SIZE  (ALIGN(sizeof(struct task_struct), PAGE_SIZE) + PAGE_SIZE)
-
 extern char vvar_page;
 
 static inline void *get_task_addr(void)
 {
     // vtask 区域在 vvar 区域上方
     struct my_task_struct_view *view;
-    view = (struct my_task_struct_view *)(&vvar_page - VVAR_SIZE);
+    view = (struct my_task_struct_view *)(&vvar_page - VTASK_SIZE + VTASK_VIEW_PGOFF * PAGE_SIZE);
     
     return (void *)((char *)view + view->page_offset + PAGE_SIZE); // 计算 task_struct 的内核虚拟地址
 }
 
+// 稳定的 vtask_data 页紧挨在 vvar 区域下方
+static inline const struct vtask_data *get_task_data(void)
+{
+    return (const struct vtask_data *)(&vvar_page - PAGE_SIZE);
+}
+
+// 全系统共享的调度负载提示页
+static inline const struct vsched_data *get_sched_data(void)
+{
+    return (const struct vsched_data *)(&vvar_page - VTASK_SIZE + VTASK_SCHED_PGOFF * PAGE_SIZE);
+}
+
+// 全系统共享的内存压力页
+static inline const struct vpsi_data *get_psi_data(void)
+{
+    return (const struct vpsi_data *)(&vvar_page - VTASK_SIZE + VTASK_PSI_PGOFF * PAGE_SIZE);
+}
+
+static inline u32 vtask_read_begin(const struct vtask_data *data)
+{
+    u32 seq;
+
+    while (unlikely((seq = READ_ONCE(data->seq)) & 1))
+        cpu_relax();
+
+    smp_rmb();
+    return seq;
+}
+
+static inline bool vtask_read_retry(const struct vtask_data *data, u32 start)
+{
+    smp_rmb();
+    return unlikely(READ_ONCE(data->seq) != start);
+}
+
 int __vdso_get_task_struct_info(struct task_info *info)
 {
-    struct task_struct *task;
     if (!info)
         return -1;
     
     // 直接从映射的内存中读取task_struct
-    task = (struct task_struct *)get_task_addr();
-        
-    info->kaddr = task;
-    info->pid = task->pid;
+    info->kaddr = (struct task_struct *)get_task_addr();
+    info->pid = READ_ONCE(get_task_data()->pid);
     
     return 0;
 }
@@ -43,3 +76,177 @@ int get_task_struct_info(struct task_info *info)
 {
     return __vdso_get_task_struct_info(info);
 }
+
+/**
+ * 读取稳定 ABI 的 vtask_data 快照，cpu/node 取调用时所在的 CPU
+ * @return 成功返回 0，失败返回 -1
+ * @note 这是每进程的页，其中的 tid 只属于主线程，所以 out->tid 总是置 0；
+ *       当前线程的 tid 用 __vdso_gettid
+ */
+int __vdso_get_task_data(struct vtask_data *out)
+{
+    const struct vtask_data *data = get_task_data();
+    unsigned int cpu, node;
+    u32 seq;
+
+    if (!out)
+        return -1;
+
+    do {
+        seq = vtask_read_begin(data);
+        *out = *data;
+    } while (vtask_read_retry(data, seq));
+
+    vdso_read_cpunode(&cpu, &node);
+    out->cpu = cpu;
+    out->node = node;
+    out->tid = 0;
+    return 0;
+}
+
+pid_t __vdso_getpid(void)
+{
+    return READ_ONCE(get_task_data()->pid);
+}
+
+static __always_inline long gettid_fallback(void)
+{
+    long ret;
+
+    asm volatile ("syscall" : "=a" (ret) : "0" (__NR_gettid) : "rcx", "r11", "memory");
+    return ret;
+}
+
+/**
+ * 返回当前线程的 tid
+ * @param self 当前线程的 vtask_data 页 (vtask_register 的返回值)，为 NULL
+ *        时退回 gettid 系统调用
+ */
+pid_t __vdso_gettid(const struct vtask_data *self)
+{
+    if (!self)
+        return gettid_fallback();
+    return READ_ONCE(self->tid);
+}
+
+/**
+ * 不进内核计算当前线程的 CPU 时间 (CLOCK_THREAD_CPUTIME_ID)
+ * @param self 当前线程的 vtask_data 页 (vtask_register 的返回值)
+ * @param ns 输出，单位纳秒
+ * @return 成功返回 0；时钟源不是 TSC 或页面版本过旧时返回 -1，调用者应退回
+ *         clock_gettime 系统调用
+ */
+int __vdso_thread_cputime(const struct vtask_data *self, u64 *ns)
+{
+    const struct vdso_data *vd = __arch_get_vdso_data();
+    u64 sum, tsc, now;
+    u32 seq;
+
+    if (!self || !ns || READ_ONCE(self->version) < 2)
+        return -1;
+    if (READ_ONCE(vd->clock_mode) != VDSO_CLOCKMODE_TSC)
+        return -1;
+
+    do {
+        seq = vtask_read_begin(self);
+        sum = self->sum_exec_runtime;
+        tsc = self->switch_tsc;
+        now = rdtsc_ordered();
+    } while (vtask_read_retry(self, seq));
+
+    if (unlikely(now < tsc))
+        now = tsc;
+    *ns = sum + mul_u64_u32_shr(now - tsc, READ_ONCE(vd->mult), READ_ONCE(vd->shift));
+    return 0;
+}
+
+/**
+ * 与 getcpu 相同，但从当前线程的 vtask 页读取，不用 RDPID/LSL
+ * @param self 当前线程的 vtask_data 页 (vtask_register 的返回值)，为 NULL
+ *        时退回到 vDSO 自带的 getcpu 实现
+ * @return 总是返回 0
+ */
+int __vdso_vtask_getcpu(const struct vtask_data *self, unsigned int *cpu, unsigned int *node)
+{
+    unsigned int c, n;
+    u32 seq;
+
+    if (!self) {
+        vdso_read_cpunode(&c, &n);
+    } else {
+        do {
+            seq = vtask_read_begin(self);
+            c = self->cpu;
+            n = self->node;
+        } while (vtask_read_retry(self, seq));
+    }
+
+    if (cpu)
+        *cpu = c;
+    if (node)
+        *node = n;
+    return 0;
+}
+
+/**
+ * 返回调度负载提示页，调用者可以直接读任意 CPU 的 nr_running
+ */
+const struct vsched_data *__vdso_sched_data(void)
+{
+    return get_sched_data();
+}
+
+/**
+ * 读取当前 CPU 和全系统的负载提示，用来决定要唤醒多少个 worker
+ * @return 成功返回 0，失败返回 -1
+ */
+int __vdso_sched_hint(struct vsched_hint *out)
+{
+    const struct vsched_data *vs = get_sched_data();
+    unsigned int cpu, node;
+
+    if (!out)
+        return -1;
+
+    vdso_read_cpunode(&cpu, &node);
+    out->cpu = cpu;
+    out->node = node;
+    out->nr_cpus = READ_ONCE(vs->nr_cpus);
+    out->nr_idle = READ_ONCE(vs->nr_idle);
+    out->nr_running = cpu < out->nr_cpus ? READ_ONCE(vs->cpus[cpu].nr_running) : 0;
+    return 0;
+}
+
+/**
+ * 返回内存压力页，只关心 "有没有新的压力" 的调用者直接比较 events 即可
+ */
+const struct vpsi_data *__vdso_psi_data(void)
+{
+    return get_psi_data();
+}
+
+/**
+ * 读取一致的内存 PSI 快照 (与 /proc/pressure/memory 同源)
+ * @return 成功返回 0；内核关闭了 PSI (从未刷新过) 时返回 -1
+ */
+int __vdso_mem_pressure(struct vpsi_data *out)
+{
+    const struct vpsi_data *vp = get_psi_data();
+    u32 seq;
+
+    if (!out)
+        return -1;
+
+    do {
+        seq = READ_ONCE(vp->seq);
+        while (unlikely(seq & 1)) {
+            cpu_relax();
+            seq = READ_ONCE(vp->seq);
+        }
+        smp_rmb();
+        *out = *vp;
+        smp_rmb();
+    } while (unlikely(READ_ONCE(vp->seq) != seq));
+
+    return out->update_ns ? 0 : -1;
+}
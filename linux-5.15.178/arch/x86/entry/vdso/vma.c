@@ -15,6 +15,17 @@
 #include <linux/cpu.h>
 #include <linux/ptrace.h>
 #include <linux/time_namespace.h>
+#include <linux/topology.h>
+#include <linux/idr.h>
+#include <linux/pfn_t.h>
+#include <linux/syscalls.h>
+#include <linux/percpu.h>
+#include <linux/psi.h>
+#include <linux/sched/loadavg.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/uaccess.h>
+#include <trace/events/sched.h>
 
 #include <asm/pvclock.h>
 #include <asm/vgtod.h>
@@ -25,10 +36,14 @@
 #include <asm/page.h>
 #include <asm/desc.h>
 #include <asm/cpufeature.h>
+#include <asm/msr.h>
 #include <clocksource/hyperv_timer.h>
 
 #include <linux/user_taskinfo.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/vtask.h>
+
 #undef _ASM_X86_VVAR_H
 #define EMIT_VVAR(name, offset)	\
 	const size_t name ## _offset = offset;
@@ -150,11 +165,8 @@ static inline struct page *find_timens_vvar_page(struct vm_area_struct *vma)
 }
 #endif
 
-static vm_fault_t vvar_fault(const struct vm_special_mapping *sm,
-		      struct vm_area_struct *vma, struct vm_fault *vmf)
+static vm_fault_t __vvar_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 {
-	pr_info("vvar_fault: vma->vm_start = %lx, vma->vm_end = %lx, vmf->pgoff = %lx\n",
-		vma->vm_start, vma->vm_end, vmf->pgoff);
 	const struct vdso_image *image = vma->vm_mm->context.vdso_image;
 	unsigned long pfn;
 	long sym_offset;
@@ -233,50 +245,252 @@ static vm_fault_t vvar_fault(const struct vm_special_mapping *sm,
 	return VM_FAULT_SIGBUS;
 }
 
-#define VTASK_SIZE  (ALIGN(sizeof(struct task_struct), PAGE_SIZE) + PAGE_SIZE)
+static vm_fault_t vvar_fault(const struct vm_special_mapping *sm,
+		      struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	vm_fault_t ret = __vvar_fault(vma, vmf);
 
-static vm_fault_t vtask_fault(const struct vm_special_mapping *sm,
-                      struct vm_area_struct *vma, struct vm_fault *vmf)
+	trace_vtask_vvar_fault(vma, vmf, ret);
+	return ret;
+}
+
+/* 每次填充 vtask_data 页时递增，fork 后子进程拿到新的 generation */
+static atomic64_t vtask_generation = ATOMIC64_INIT(0);
+
+static void vtask_fill_data(struct vtask_data *data, pid_t pid, pid_t tid, int cpu)
+{
+	data->version = VTASK_DATA_VERSION;
+	data->seq = 0;
+	data->generation = atomic64_inc_return(&vtask_generation);
+	data->pid = pid;
+	data->tid = tid;
+	data->cpu = cpu;
+	data->node = cpu_to_node(cpu);
+}
+
+/*
+ * view/data 页缓存在 task 中 (多持有一个引用)，exec 时如果旧 mm 已经
+ * 不再映射它们 (引用计数只剩缓存这一个) 就直接复用，否则换新页
+ */
+static struct page *vtask_get_page(struct task_struct *tsk, int idx)
+{
+	struct page *page = tsk->vtask_pages[idx];
+
+	if (page && page_ref_count(page) == 1) {
+		clear_page(page_address(page));
+		return page;
+	}
+	if (page)
+		put_page(page);
+
+	page = alloc_page(GFP_KERNEL | __GFP_ZERO);
+	tsk->vtask_pages[idx] = page;
+	return page;
+}
+
+void vtask_free_pages(struct task_struct *tsk)
+{
+	int i;
+
+	for (i = 0; i < VTASK_NR_PAGES; i++) {
+		if (tsk->vtask_pages[i])
+			put_page(tsk->vtask_pages[i]);
+		tsk->vtask_pages[i] = NULL;
+	}
+}
+
+/*
+ * 填充并插入 @tsk 的 view/data 页，@pid/@tid 为 @tsk 在自己 pid namespace
+ * 中的编号。插入后页面由页表持有引用，随 mm 一起释放。
+ */
+static int vtask_populate(struct vm_area_struct *vma, struct task_struct *tsk,
+			  pid_t pid, pid_t tid)
+{
+	struct my_task_struct_view *view;
+	struct page *view_page, *data_page;
+	int ret;
+
+	view_page = vtask_get_page(tsk, VTASK_PAGE_VIEW);
+	data_page = vtask_get_page(tsk, VTASK_PAGE_DATA);
+	if (!view_page || !data_page)
+		return -ENOMEM;
+
+	view = page_address(view_page);
+	view->page_offset = __pa((char *)tsk) & (~PAGE_MASK);
+	view->pid = tsk->pid;
+	vtask_fill_data(page_address(data_page), pid, tid, task_cpu(tsk));
+
+	ret = vm_insert_page(vma, vma->vm_start + VTASK_VIEW_PGOFF * PAGE_SIZE, view_page);
+	if (ret)
+		return ret;
+	return vm_insert_page(vma, vma->vm_start + VTASK_DATA_PGOFF * PAGE_SIZE, data_page);
+}
+
+/*
+ * 全系统共享的调度负载提示页 (struct vsched_data)。runqueue 长度变化时
+ * 调度器会触发 sched_update_nr_running_tp (在该 rq 的锁内)，我们在这里
+ * 更新对应 CPU 的那一行；nr_idle 只在 CPU 空闲/忙碌切换时原子加减。
+ * 页面在启动时分配，进程访问时才插入页表。
+ */
+static struct vsched_data *vsched_data;
+static unsigned int vsched_nr_pages;
+static DEFINE_PER_CPU(bool, vsched_idle);	/* 该 CPU 是否已计入 nr_idle, 受 rq 锁保护 */
+
+static void vsched_set_idle(int cpu, bool idle)
+{
+	if (per_cpu(vsched_idle, cpu) == idle)
+		return;
+	per_cpu(vsched_idle, cpu) = idle;
+	atomic_add(idle ? 1 : -1, (atomic_t *)&vsched_data->nr_idle);
+}
+
+static void vsched_nr_running(void *ignore, struct rq *rq, int change)
+{
+	int cpu = sched_trace_rq_cpu(rq);
+	unsigned int nr = sched_trace_rq_nr_running(rq);
+
+	if (unlikely(cpu < 0 || cpu >= vsched_data->nr_cpus))
+		return;
+
+	WRITE_ONCE(vsched_data->cpus[cpu].nr_running, nr);
+	// 正在下线的 CPU 不算空闲，上线后的第一次更新会把它重新计入
+	vsched_set_idle(cpu, nr == 0 && cpu_online(cpu));
+}
+
+static int __init vsched_init(void)
+{
+	size_t size = struct_size(vsched_data, cpus, nr_cpu_ids);
+	int cpu, ret;
+
+	// alloc_pages_exact 拆分成独立的 0 阶页，才能逐页插入用户页表
+	vsched_data = alloc_pages_exact(size, GFP_KERNEL | __GFP_ZERO);
+	if (!vsched_data)
+		return -ENOMEM;
+	vsched_nr_pages = PAGE_ALIGN(size) >> PAGE_SHIFT;
+
+	vsched_data->version = VSCHED_DATA_VERSION;
+	vsched_data->nr_cpus = nr_cpu_ids;
+
+	// 初始值只是近似，每个 CPU 的下一次 runqueue 变化会把它校正
+	for_each_online_cpu(cpu) {
+		if (idle_cpu(cpu))
+			vsched_set_idle(cpu, true);
+		else
+			vsched_data->cpus[cpu].nr_running = 1;
+	}
+
+	ret = register_trace_sched_update_nr_running_tp(vsched_nr_running, NULL);
+	if (ret)
+		pr_warn("vsched: failed to register nr_running probe: %d\n", ret);
+	return 0;
+}
+
+static vm_fault_t vsched_fault(struct vm_fault *vmf, unsigned long idx)
+{
+	if (!vsched_data || idx >= vsched_nr_pages)
+		return VM_FAULT_SIGBUS;
+
+	vmf->page = virt_to_page((char *)vsched_data + (idx << PAGE_SHIFT));
+	get_page(vmf->page);
+	return 0;
+}
+
+/*
+ * 全系统的内存压力页 (struct vpsi_data)，内容与 /proc/pressure/memory 相同。
+ * 用可延迟的 delayed work 每 VPSI_PERIOD_MS 从 psi_system 拷贝一次，CPU
+ * 空闲时不会为它唤醒。PSI 本身每 2 秒才更新一次 avg，累计的 stall 时间
+ * 则由 PSI 的 avgs_work 刷新。
+ */
+static struct vpsi_data *vpsi_data;
+
+static u32 vpsi_avg(unsigned long avg)
+{
+	// 与 psi_show 的 "%lu.%02lu" 一致, 单位 0.01%
+	return LOAD_INT(avg) * 100 + LOAD_FRAC(avg);
+}
+
+static void vpsi_refresh(struct work_struct *work);
+static DECLARE_DEFERRABLE_WORK(vpsi_work, vpsi_refresh);
+
+static void vpsi_refresh(struct work_struct *work)
+{
+#ifdef CONFIG_PSI
+	struct vpsi_data *vp = vpsi_data;
+	u64 some = psi_system.total[PSI_AVGS][PSI_MEM_SOME] / NSEC_PER_USEC;
+	u64 full = psi_system.total[PSI_AVGS][PSI_MEM_FULL] / NSEC_PER_USEC;
+	int w;
+
+	if (static_branch_likely(&psi_disabled))
+		return;
+
+	WRITE_ONCE(vp->seq, vp->seq + 1);
+	smp_wmb();
+	if (some != vp->some_total)
+		vp->events++;
+	for (w = 0; w < 3; w++) {
+		vp->some_avg[w] = vpsi_avg(psi_system.avg[PSI_MEM_SOME][w]);
+		vp->full_avg[w] = vpsi_avg(psi_system.avg[PSI_MEM_FULL][w]);
+	}
+	vp->some_total = some;
+	vp->full_total = full;
+	vp->update_ns = ktime_get_ns();
+	smp_wmb();
+	WRITE_ONCE(vp->seq, vp->seq + 1);
+
+	queue_delayed_work(system_power_efficient_wq, &vpsi_work,
+			   msecs_to_jiffies(VPSI_PERIOD_MS));
+#endif
+}
+
+static int __init vpsi_init(void)
+{
+	vpsi_data = (struct vpsi_data *)get_zeroed_page(GFP_KERNEL);
+	if (!vpsi_data)
+		return -ENOMEM;
+
+	vpsi_data->version = VPSI_DATA_VERSION;
+	vpsi_refresh(NULL);
+	return 0;
+}
+
+static vm_fault_t vpsi_fault(struct vm_fault *vmf)
+{
+	if (!vpsi_data)
+		return VM_FAULT_SIGBUS;
+
+	vmf->page = virt_to_page(vpsi_data);
+	get_page(vmf->page);
+	return 0;
+}
+
+static vm_fault_t __vtask_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 {
-	pr_info("vtask_fault: vma->vm_start = %lx, vma->vm_end = %lx, vmf->pgoff = %lx\n",
-        vma->vm_start, vma->vm_end, vmf->pgoff);
-	
 	unsigned long offset = vmf->pgoff << PAGE_SHIFT;
 
 	if (offset >= VTASK_SIZE)
 		return VM_FAULT_SIGBUS;
 
-	unsigned long task_struct_offset = __pa((char *)current) & (~PAGE_MASK);
-	pr_info("_pa(current) = %lx, offset = %ld\n", __pa(current), task_struct_offset);
-	// 第一个页面用于映射 task_struct_view
-	if (vmf->pgoff == 0) {
-		pr_info("create a page for task_struct_view \npage_offset=%lx pid=%d\n", task_struct_offset, current->pid);
-		// 创建一个页面
-		struct page *page;
-        struct my_task_struct_view *view;
-        
-        // 分配一个页面用于存放结构体视图
-        page = alloc_page(GFP_KERNEL);
-        if (!page)
-            return VM_FAULT_OOM;
-            
-        // 获取页面地址并填充结构体
-        view = page_address(page);
-        memset(view, 0, PAGE_SIZE);  // 清空页面
-        
-        // 填充结构体信息
-        view->page_offset = task_struct_offset;
-        view->pid = current->pid;
-        
-        // 将该页映射到用户空间
-        get_page(page);
-        vmf->page = page;
-        return 0;
-	} else {
-		return vmf_insert_pfn(vma, vmf->address,
-			(__pa((char *)current + offset - PAGE_SIZE)) >> PAGE_SHIFT);
-		
-	}		
+	// 每线程页、view 页和 vtask_data 页都是提前插入的，不会在这里缺页
+	if (vmf->pgoff <= VTASK_VIEW_PGOFF || vmf->pgoff == VTASK_DATA_PGOFF)
+		return VM_FAULT_SIGBUS;
+
+	if (vmf->pgoff == VTASK_PSI_PGOFF)
+		return vpsi_fault(vmf);
+	if (vmf->pgoff >= VTASK_SCHED_PGOFF)
+		return vsched_fault(vmf, vmf->pgoff - VTASK_SCHED_PGOFF);
+
+	offset -= (VTASK_VIEW_PGOFF + 1) << PAGE_SHIFT;
+	return vmf_insert_mixed(vma, vmf->address,
+		pfn_to_pfn_t(__pa((char *)current + offset) >> PAGE_SHIFT));
+}
+
+static vm_fault_t vtask_fault(const struct vm_special_mapping *sm,
+                      struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	vm_fault_t ret = __vtask_fault(vma, vmf);
+
+	trace_vtask_fault(vma, vmf, ret);
+	return ret;
 }
 
 static const struct vm_special_mapping vdso_mapping = {
@@ -293,6 +507,357 @@ static const struct vm_special_mapping vtask_mapping = {
     .fault = vtask_fault,
 };
 
+static struct vm_area_struct *vtask_find_vma(struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (vma_is_special_mapping(vma, &vtask_mapping))
+			return vma;
+	}
+	return NULL;
+}
+
+/**
+ * fork 出新 mm 时为子进程装好 view/data 页 ([vtask] 是 VM_WIPEONFORK，
+ * 不会从父进程继承)；@pid 是子进程的 struct pid。调用时 p->pid/p->tgid
+ * 必须已经设好，vtask_populate 会把它们写进 view 页。
+ */
+int vtask_fork(struct task_struct *p, struct pid *pid)
+{
+	struct mm_struct *mm = p->mm;
+	struct vm_area_struct *vma;
+	pid_t nr = pid_nr_ns(pid, ns_of_pid(pid));
+	int ret = 0;
+
+	mmap_read_lock(mm);
+	vma = vtask_find_vma(mm);
+	if (vma)
+		ret = vtask_populate(vma, p, nr, nr);
+	mmap_read_unlock(mm);
+	return ret;
+}
+
+#ifdef CONFIG_PREEMPT_NOTIFIERS
+/*
+ * 在 @vma 的线程区里找一个空 slot 插入 @page，返回 slot 号。slot 是否被
+ * 占用就看页表：vm_insert_page 在 pte 非空时返回 -EBUSY，检查和插入都在
+ * pte 锁内，并发注册的线程不会拿到同一个 slot；vtask_release 把页摘掉
+ * 就是释放。这样每个进程各自有 VTASK_MAX_THREADS 个 slot，互不影响。
+ */
+static int vtask_insert_slot(struct vm_area_struct *vma, struct page *page)
+{
+	unsigned long addr;
+	int slot, ret;
+
+	for (slot = 0; slot < VTASK_MAX_THREADS; slot++) {
+		addr = vma->vm_start + ((VTASK_THREAD_PGOFF + slot) << PAGE_SHIFT);
+		ret = vm_insert_page(vma, addr, page);
+		if (ret != -EBUSY)
+			return ret ? ret : slot;
+	}
+	return -EAGAIN;
+}
+
+/*
+ * 被切走时停在可重启区间内就从 abort_ip 重新开始：无论是被抢占还是迁移，
+ * 区间里读到的 cpu 都可能已经过期，只有最后一条提交指令之后才安全。
+ * sched_in 时 current 就是这个线程，返回用户态用的正是这里的 regs。
+ */
+static void vtask_restart_cs(struct vtask_thread *vt, struct pt_regs *regs)
+{
+	if (regs->ip - vt->cs_start < vt->cs_end - vt->cs_start && user_mode(regs))
+		regs->ip = vt->cs_abort;
+}
+
+/**
+ * 建立信号栈帧之前调用 (见 rseq_signal_deliver)：信号处理函数里也可能
+ * vpercpu_add，和被打断的那次提交交错。和 rseq 一样先把 ip 改到 abort_ip，
+ * 保存进信号帧、sigreturn 后恢复的就是 abort_ip。
+ */
+void vtask_signal_deliver(struct pt_regs *regs)
+{
+	struct vtask_thread *vt = current->vtask;
+
+	if (vt && vt->cs_end)
+		vtask_restart_cs(vt, regs);
+}
+
+/*
+ * 每次被调度进来时发布 cpu/node (和 rseq 的 cpu_id 类似) 以及到此为止的
+ * CPU 时间和当前 TSC，vDSO 据此算出线程 CPU 时间。seq 每次都要递增，
+ * 这样读者在中途被切走时一定会重试。
+ */
+static void vtask_sched_in(struct preempt_notifier *notifier, int cpu)
+{
+	struct vtask_thread *vt = container_of(notifier, struct vtask_thread, notifier);
+	struct vtask_data *data = vt->data;
+
+	if (vt->cs_end)
+		vtask_restart_cs(vt, task_pt_regs(current));
+
+	WRITE_ONCE(data->seq, data->seq + 1);
+	smp_wmb();
+	if (unlikely(data->cpu != cpu)) {
+		data->cpu = cpu;
+		data->node = cpu_to_node(cpu);
+	}
+	data->sum_exec_runtime = current->se.sum_exec_runtime;
+	data->switch_tsc = rdtsc_ordered();
+	smp_wmb();
+	WRITE_ONCE(data->seq, data->seq + 1);
+}
+
+static void vtask_sched_out(struct preempt_notifier *notifier,
+			    struct task_struct *next)
+{
+}
+
+static struct preempt_ops vtask_preempt_ops = {
+	.sched_in = vtask_sched_in,
+	.sched_out = vtask_sched_out,
+};
+
+static long vtask_register_current(void)
+{
+	struct task_struct *tsk = current;
+	struct mm_struct *mm = tsk->mm;
+	struct vm_area_struct *vma;
+	struct vtask_thread *vt;
+	long ret;
+
+	if (tsk->vtask)
+		return tsk->vtask->uaddr;
+
+	vt = kzalloc(sizeof(*vt), GFP_KERNEL);
+	if (!vt)
+		return -ENOMEM;
+
+	vt->page = alloc_page(GFP_KERNEL | __GFP_ZERO);
+	if (!vt->page) {
+		ret = -ENOMEM;
+		goto free_vt;
+	}
+	vt->data = page_address(vt->page);
+	vtask_fill_data(vt->data, task_tgid_vnr(tsk), task_pid_vnr(tsk), task_cpu(tsk));
+
+	mmap_read_lock(mm);
+	vma = vtask_find_vma(mm);
+	if (!vma) {
+		mmap_read_unlock(mm);
+		ret = -ENOENT;
+		goto free_page;
+	}
+	ret = vtask_insert_slot(vma, vt->page);
+	if (ret >= 0) {
+		vt->slot = ret;
+		vt->uaddr = vma->vm_start + ((VTASK_THREAD_PGOFF + vt->slot) << PAGE_SHIFT);
+	}
+	mmap_read_unlock(mm);
+	if (ret < 0)
+		goto free_page;
+
+	preempt_notifier_inc();
+	preempt_notifier_init(&vt->notifier, &vtask_preempt_ops);
+	preempt_notifier_register(&vt->notifier);
+
+	// 注册期间可能已被迁移
+	preempt_disable();
+	vtask_sched_in(&vt->notifier, smp_processor_id());
+	preempt_enable();
+
+	tsk->vtask = vt;
+	return vt->uaddr;
+
+free_page:
+	__free_page(vt->page);
+free_vt:
+	kfree(vt);
+	return ret;
+}
+
+/**
+ * 撤销 @tsk 的每线程页，@tsk 必须是 current；线程退出、exec 和
+ * VTASK_UNREGISTER 时调用
+ */
+void vtask_release(struct task_struct *tsk, struct mm_struct *mm)
+{
+	struct vtask_thread *vt = tsk->vtask;
+	struct vm_area_struct *vma;
+
+	if (!vt)
+		return;
+	tsk->vtask = NULL;
+
+	preempt_notifier_unregister(&vt->notifier);
+	preempt_notifier_dec();
+
+	// 从页表中摘掉，页面在最后一个引用消失时释放
+	if (mm) {
+		mmap_read_lock(mm);
+		vma = find_vma(mm, vt->uaddr);
+		if (vma && vma->vm_start <= vt->uaddr &&
+		    vma_is_special_mapping(vma, &vtask_mapping))
+			zap_page_range(vma, vt->uaddr, PAGE_SIZE);
+		mmap_read_unlock(mm);
+	}
+
+	put_page(vt->page);
+	kfree(vt);
+}
+
+static long vtask_set_cs(const struct vtask_cs __user *ucs)
+{
+	struct vtask_thread *vt = current->vtask;
+	struct vtask_cs cs;
+
+	if (!vt)
+		return -ENOENT;
+
+	if (!ucs) {
+		vt->cs_end = 0;
+		return 0;
+	}
+	if (copy_from_user(&cs, ucs, sizeof(cs)))
+		return -EFAULT;
+	if (cs.start_ip >= cs.post_commit_ip || cs.post_commit_ip > TASK_SIZE_MAX ||
+	    cs.abort_ip >= TASK_SIZE_MAX ||
+	    (cs.abort_ip >= cs.start_ip && cs.abort_ip < cs.post_commit_ip))
+		return -EINVAL;
+
+	// 只有本线程的 sched_in 会读，关抢占即可保证它看到完整的区间
+	preempt_disable();
+	vt->cs_start = cs.start_ip;
+	vt->cs_abort = cs.abort_ip;
+	vt->cs_end = cs.post_commit_ip;
+	preempt_enable();
+	return 0;
+}
+
+// asmlinkage long sys_vtask_register(unsigned int flags, const struct vtask_cs __user *cs); 455
+SYSCALL_DEFINE2(vtask_register, unsigned int, flags, const struct vtask_cs __user *, cs)
+{
+	if (flags & ~(VTASK_UNREGISTER | VTASK_SET_CS))
+		return -EINVAL;
+
+	if (flags & VTASK_UNREGISTER) {
+		if (flags & VTASK_SET_CS)
+			return -EINVAL;
+		if (!current->vtask)
+			return -ENOENT;
+		vtask_release(current, current->mm);
+		return 0;
+	}
+
+	if (flags & VTASK_SET_CS)
+		return vtask_set_cs(cs);
+
+	return vtask_register_current();
+}
+#else
+void vtask_release(struct task_struct *tsk, struct mm_struct *mm)
+{
+}
+
+void vtask_signal_deliver(struct pt_regs *regs)
+{
+}
+
+// 没有 preempt notifier 就无法在迁移时更新 cpu
+SYSCALL_DEFINE2(vtask_register, unsigned int, flags, const struct vtask_cs __user *, cs)
+{
+	return -ENOSYS;
+}
+#endif /* CONFIG_PREEMPT_NOTIFIERS */
+
+/*
+ * 每进程的 per-CPU 可写区域 [vpercpu]：nr_cpu_ids 个 slot，每个 slot
+ * 页对齐，所有线程共享 (VM_SHARED，写时不 COW)。没有 vm_file，走不了
+ * 共享映射的缺页路径 (do_shared_fault 要更新文件时间)，所以 setup 时
+ * 就把每个 slot 的页分配在所属 CPU 的节点上，用 vm_insert_page 插好
+ * (VM_MIXEDMAP，pte 本身可写，之后的写不会缺页)。页面记在调用者的
+ * memcg 上，由页表持有，随 munmap/exit 释放；不可能出现的 CPU 的 slot
+ * 不分配，和被 madvise 等摘掉的页一样，访问只能 SIGBUS。
+ */
+static vm_fault_t vpercpu_fault(const struct vm_special_mapping *sm,
+				struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	return VM_FAULT_SIGBUS;
+}
+
+static int vpercpu_populate(struct vm_area_struct *vma, unsigned long slot_pages)
+{
+	unsigned long i, addr;
+	struct page *page;
+	int cpu, node, ret;
+
+	for_each_possible_cpu(cpu) {
+		node = cpu_to_node(cpu);
+		addr = vma->vm_start + cpu * (slot_pages << PAGE_SHIFT);
+		for (i = 0; i < slot_pages; i++, addr += PAGE_SIZE) {
+			page = alloc_pages_node(node, GFP_KERNEL_ACCOUNT | __GFP_ZERO, 0);
+			if (!page)
+				return -ENOMEM;
+			// vm_insert_page 自己拿一个引用
+			ret = vm_insert_page(vma, addr, page);
+			put_page(page);
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+static const struct vm_special_mapping vpercpu_mapping = {
+	.name = "[vpercpu]",
+	.fault = vpercpu_fault,
+};
+
+// asmlinkage long sys_vpercpu_setup(unsigned long size, unsigned int flags); 459
+SYSCALL_DEFINE2(vpercpu_setup, unsigned long, size, unsigned int, flags)
+{
+	struct mm_struct *mm = current->mm;
+	struct vm_area_struct *vma;
+	unsigned long len, addr;
+	int ret;
+
+	if (flags || !size || size > VPERCPU_MAX_SIZE)
+		return -EINVAL;
+	len = PAGE_ALIGN(size) * nr_cpu_ids;
+
+	if (mmap_write_lock_killable(mm))
+		return -EINTR;
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (vma_is_special_mapping(vma, &vpercpu_mapping)) {
+			addr = -EEXIST;
+			goto out;
+		}
+	}
+
+	addr = get_unmapped_area(NULL, 0, len, 0, 0);
+	if (IS_ERR_VALUE(addr))
+		goto out;
+
+	vma = _install_special_mapping(mm, addr, len,
+				       VM_READ|VM_WRITE|VM_SHARED|
+				       VM_MAYREAD|VM_MAYWRITE|VM_MAYSHARE|
+				       VM_DONTCOPY|VM_DONTEXPAND|VM_MIXEDMAP,
+				       &vpercpu_mapping);
+	if (IS_ERR(vma)) {
+		addr = PTR_ERR(vma);
+		goto out;
+	}
+	ret = vpercpu_populate(vma, PAGE_ALIGN(size) >> PAGE_SHIFT);
+	if (ret) {
+		do_munmap(mm, addr, len, NULL);
+		addr = ret;
+	}
+out:
+	mmap_write_unlock(mm);
+	return addr;
+}
+
 /*
  * Add vdso and vvar mappings to current process.
  * @image          - blob to map
@@ -300,22 +865,18 @@ static const struct vm_special_mapping vtask_mapping = {
  */
 static int map_vdso(const struct vdso_image *image, unsigned long addr)
 {
-	pr_info("map_vdso: mapping vdso image at addr 0x%lx (image size: 0x%lx, vvar offset: 0x%lx)\n",
-		addr, image->size, image->sym_vvar_start);
-	pr_info("current pid: %d command: %s kaddr: %p\n", current->pid, current->comm, current);
 	struct mm_struct *mm = current->mm;
 	struct vm_area_struct *vma;
-	unsigned long text_start;
-	unsigned long vtask_start;
-	unsigned long vvar_start;
+	unsigned long text_start = 0;
+	unsigned long vtask_start = 0;
+	unsigned long vvar_start = 0;
 	unsigned long vvar_size = -image->sym_vvar_start;
+	u64 t0 = trace_vtask_map_vdso_enabled() ? ktime_get_ns() : 0;
 	int ret = 0;
 
 	if (mmap_write_lock_killable(mm))
 		return -EINTR;
 
-
-	pr_info("fucksize = %lx\n", image->size - image->sym_vvar_start + VTASK_SIZE);
 	addr = get_unmapped_area(NULL, addr,
 				 image->size - image->sym_vvar_start + VTASK_SIZE, 0, 0);
 	if (IS_ERR_VALUE(addr)) {
@@ -327,7 +888,6 @@ static int map_vdso(const struct vdso_image *image, unsigned long addr)
 	vvar_start = addr + VTASK_SIZE;
 	text_start = addr + VTASK_SIZE + vvar_size;
 
-	pr_info("map_vdso: trying to map vdso area addr=%lx size=%lx\n", text_start, image->size);
 	/*
 	 * MAYWRITE to allow gdb to COW and set breakpoints
 	 */
@@ -343,7 +903,6 @@ static int map_vdso(const struct vdso_image *image, unsigned long addr)
 		goto up_fail;
 	}
 
-	pr_info("map_vdso: trying to map vvar area addr=%lx size=%lx\n", vvar_start, vvar_size);
 	// 映射vvar区域
     vma = _install_special_mapping(mm,
 					   vvar_start,
@@ -359,39 +918,36 @@ static int map_vdso(const struct vdso_image *image, unsigned long addr)
     }
 	
 
-	pr_info("map_vdso: trying to map vtask area addr=%lx size=%lx\n", vtask_start, VTASK_SIZE);
-
     // 映射task_struct到vvar紧邻的区域
     vma = _install_special_mapping(mm,
 					  vtask_start, 
                       VTASK_SIZE,
-                      VM_READ|VM_MAYREAD|VM_DONTDUMP|VM_IO|VM_PFNMAP|VM_WIPEONFORK,
+                      VM_READ|VM_MAYREAD|VM_DONTDUMP|VM_IO|VM_MIXEDMAP|VM_WIPEONFORK,
                       &vtask_mapping);
      
     if (IS_ERR(vma)) {
-		// debug
-		pr_info("map_vdso: ERROR: Failed to install vtask mapping\n");
-		struct vm_area_struct *tmp;
-		pr_info("map_vdso: Dumping all VMAs for current process (pid=%d):\n", current->pid);
-		for (tmp = mm->mmap; tmp; tmp = tmp->vm_next) {
-			pr_info("  VMA: start=0x%lx end=0x%lx flags=0x%lx name=%s\n",
-					tmp->vm_start, tmp->vm_end, tmp->vm_flags,
-					tmp->vm_file ? (tmp->vm_file->f_path.dentry->d_name.name) :
-					(tmp->vm_ops && tmp->vm_ops->name ? tmp->vm_ops->name : ""));
-		}
-
         ret = PTR_ERR(vma);
-		pr_info("ret = %d\n", ret);
         do_munmap(mm, text_start, image->size, NULL);
 		do_munmap(mm, vvar_start, vvar_size, NULL);
         goto up_fail;
     }
 
+	// exec 时就装好 view/data 页，第一次 vDSO 调用不再缺页
+	ret = vtask_populate(vma, current, task_tgid_vnr(current), task_pid_vnr(current));
+	if (ret) {
+		do_munmap(mm, text_start, image->size, NULL);
+		do_munmap(mm, vvar_start, vvar_size, NULL);
+		do_munmap(mm, vtask_start, VTASK_SIZE, NULL);
+		goto up_fail;
+	}
+
 	current->mm->context.vdso = (void __user *)text_start;
 	current->mm->context.vdso_image = image;
 
 up_fail:
 	mmap_write_unlock(mm);
+	trace_vtask_map_vdso(vtask_start, vvar_start, text_start, vvar_size,
+			     image->size, ret, t0 ? ktime_get_ns() - t0 : 0);
 	return ret;
 }
 
@@ -542,6 +1098,8 @@ __setup("vdso=", vdso_setup);
 
 static int __init init_vdso(void)
 {
+	int ret;
+
 	BUILD_BUG_ON(VDSO_CLOCKMODE_MAX >= 32);
 
 	init_vdso_image(&vdso_image_64);
@@ -550,7 +1108,10 @@ static int __init init_vdso(void)
 	init_vdso_image(&vdso_image_x32);
 #endif
 
-	return 0;
+	ret = vsched_init();
+	if (ret)
+		return ret;
+	return vpsi_init();
 }
 subsys_initcall(init_vdso);
 #endif /* CONFIG_X86_64 */
@@ -67,6 +67,8 @@ struct sighand_struct;
 struct signal_struct;
 struct task_delay_info;
 struct task_group;
+struct vtask_thread;
+struct xring;
 
 /*
  * Task state bitmask. NOTE! These bits are also
@@ -801,7 +803,18 @@ struct task_struct {
 	struct kv_store {
 		spinlock_t locks[1024];         /* Per-bucket locks for concurrent access */
 		struct hlist_head head[1024];   /* Hash buckets for key-value pairs */
+		refcount_t users;               /* Threads of the group + registered xrings */
 	} *kv;
+	/* Thread-private Key-Value store (KV_PRIVATE), allocated on first use */
+	struct kv_private_store {
+		struct hlist_head head[1024];   /* Only touched by the owner thread, no locks */
+	} *kv_private;
+	/* Per-thread vtask_data page, see vtask_register() */
+	struct vtask_thread		*vtask;
+	/* [vtask] view/data pages, cached for reuse across exec */
+	struct page			*vtask_pages[2];
+	/* Exception-less syscall ring, see xring_setup() */
+	struct xring			*xring;
 
 	struct sched_statistics         stats;
 
@@ -2177,6 +2190,10 @@ extern long sched_getaffinity(pid_t pid, struct cpumask *mask);
 unsigned long sched_cpu_util(int cpu, unsigned long max);
 #endif /* CONFIG_SMP */
 
+struct pt_regs;
+/* aborts a vtask restartable region before a signal frame is set up */
+void vtask_signal_deliver(struct pt_regs *regs);
+
 #ifdef CONFIG_RSEQ
 
 /*
@@ -2213,6 +2230,7 @@ static inline void rseq_handle_notify_resume(struct ksignal *ksig,
 static inline void rseq_signal_deliver(struct ksignal *ksig,
 				       struct pt_regs *regs)
 {
+	vtask_signal_deliver(regs);
 	preempt_disable();
 	__set_bit(RSEQ_EVENT_SIGNAL_BIT, &current->rseq_event_mask);
 	preempt_enable();
@@ -2269,6 +2287,7 @@ static inline void rseq_handle_notify_resume(struct ksignal *ksig,
 static inline void rseq_signal_deliver(struct ksignal *ksig,
 				       struct pt_regs *regs)
 {
+	vtask_signal_deliver(regs);
 }
 static inline void rseq_preempt(struct task_struct *t)
 {
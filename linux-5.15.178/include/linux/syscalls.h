@@ -1284,6 +1284,30 @@ asmlinkage long sys_ni_syscall(void);
  */
 asmlinkage long sys_write_kv(int k, int v);
 asmlinkage long sys_read_kv(int k);
+asmlinkage long sys_write_kv2(int k, int v, unsigned int flags);
+asmlinkage long sys_read_kv2(int k, unsigned int flags);
+asmlinkage long sys_kv_dump(int fd, unsigned int flags);
+asmlinkage long sys_kv_load(int fd, unsigned int flags);
+
+/*
+ * vtask per-thread page
+ */
+struct vtask_cs;
+asmlinkage long sys_vtask_register(unsigned int flags, const struct vtask_cs __user *cs);
+asmlinkage long sys_vpercpu_setup(unsigned long size, unsigned int flags);
+
+/*
+ * Exception-less syscall ring
+ */
+struct xring_params;
+asmlinkage long sys_xring_setup(void __user *ring, struct xring_params __user *params);
+asmlinkage long sys_xring_enter(unsigned int min_complete, unsigned int flags);
+
+/*
+ * Vector of syscalls in one entry
+ */
+struct multicall_entry;
+asmlinkage long sys_multicall(struct multicall_entry __user *vec, int n, unsigned int flags);
 
 #endif /* CONFIG_ARCH_HAS_SYSCALL_WRAPPER */
 
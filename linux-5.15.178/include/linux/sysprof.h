@@ -0,0 +1,93 @@
+#ifndef _LINUX_SYSPROF_H
+#define _LINUX_SYSPROF_H
+
+#include <linux/jump_label.h>
+#include <linux/percpu.h>
+#include <linux/string.h>
+#include <linux/timex.h>
+#include <linux/types.h>
+
+/*
+ * 自定义系统调用的开销分析 (实现在 kernel/kv_store.c)
+ *
+ * 每次采样把一次调用拆成几段，用 cycle 计数器计时，记到 per-CPU 的
+ * log2 直方图里，通过 /sys/kernel/debug/sysprof/ 开关和读取。
+ * 关闭时 sysprof_begin() 只是一个 static key 分支，没有其他开销。
+ *
+ * 各段的含义 (从 handler 入口开始算，看不到 arch 的 entry/exit 代码):
+ *   entry  参数检查、查找对象，到第一次请求锁为止
+ *   lock   等锁 (spin_lock 本身) 的时间，多次加锁时累加
+ *   work   持锁期间以及两次加锁之间的工作
+ *   exit   最后一次放锁到返回
+ */
+enum sysprof_call {
+    SYSPROF_WRITE_KV,
+    SYSPROF_READ_KV,
+    SYSPROF_SOCKET_FAIRNESS,
+    SYSPROF_NR_CALLS,
+};
+
+enum sysprof_phase {
+    SYSPROF_ENTRY,
+    SYSPROF_LOCK,
+    SYSPROF_WORK,
+    SYSPROF_EXIT,
+    SYSPROF_TOTAL,
+    SYSPROF_NR_PHASES,
+};
+
+#define SYSPROF_BUCKETS 32      /* bucket i: [2^i, 2^(i+1)) cycles */
+
+/* 一次采样，放在调用者的栈上 */
+struct sysprof_sample {
+    cycles_t start;
+    cycles_t last;
+    u64 cycles[SYSPROF_NR_PHASES];
+};
+
+DECLARE_STATIC_KEY_FALSE(sysprof_enabled);
+
+bool __sysprof_should_sample(void);
+void __sysprof_record(struct sysprof_sample *ps, enum sysprof_call call);
+
+/**
+ * @brief 决定本次调用是否采样，采样时开始计时
+ * @return true 表示 ps 有效，调用结束时必须 sysprof_end()
+ */
+static __always_inline bool sysprof_begin(struct sysprof_sample *ps)
+{
+    if (!static_branch_unlikely(&sysprof_enabled))
+        return false;
+    if (!__sysprof_should_sample())
+        return false;
+    ps->start = ps->last = get_cycles();
+    memset(ps->cycles, 0, sizeof(ps->cycles));
+    return true;
+}
+
+/**
+ * @brief 把上一个标记到现在的时间记到 phase 上
+ * @param ps 为 NULL 时什么也不做，未采样的路径直接传 NULL
+ */
+static __always_inline void sysprof_mark(struct sysprof_sample *ps, enum sysprof_phase phase)
+{
+    cycles_t now;
+
+    if (!ps)
+        return;
+    now = get_cycles();
+    ps->cycles[phase] += now - ps->last;
+    ps->last = now;
+}
+
+/**
+ * @brief 剩下的时间记为 exit，写入当前 CPU 的直方图
+ */
+static __always_inline void sysprof_end(struct sysprof_sample *ps, enum sysprof_call call)
+{
+    sysprof_mark(ps, SYSPROF_EXIT);
+    ps->cycles[SYSPROF_TOTAL] = ps->last - ps->start;
+    __sysprof_record(ps, call);
+}
+
+#endif /* _LINUX_SYSPROF_H */
@@ -1,3 +1,8 @@
+#ifndef _LINUX_USER_TASKINFO_H
+#define _LINUX_USER_TASKINFO_H
+
+#include <linux/preempt.h>
+#include <uapi/linux/vtask.h>
 
 struct my_task_struct_view {
     int page_offset; // 任务结构体在页内的偏移
@@ -9,3 +14,53 @@ struct task_info {
     pid_t pid;
 };
 
+/*
+ * [vtask] 区域布局 (紧邻 vvar 区域下方):
+ *   page 0 .. VTASK_MAX_THREADS-1  每线程的 vtask_data 页 (vtask_register 时插入)
+ *   page VTASK_VIEW_PGOFF          my_task_struct_view
+ *   之后 VTASK_TS_PAGES 页          task_struct 所在的物理页
+ *   VTASK_SCHED_PGOFF 起 VTASK_SCHED_PAGES 页
+ *                                  struct vsched_data (全系统共享, 缺页时插入)
+ *   page VTASK_PSI_PGOFF           struct vpsi_data (全系统共享, 缺页时插入)
+ *   page VTASK_DATA_PGOFF          struct vtask_data (稳定 ABI, 每进程)
+ */
+#define VTASK_MAX_THREADS   4096    /* 每个进程同时注册的线程数上限 */
+#define VTASK_THREAD_PGOFF  0
+#define VTASK_VIEW_PGOFF    (VTASK_THREAD_PGOFF + VTASK_MAX_THREADS)
+#define VTASK_TS_PAGES      (ALIGN(sizeof(struct task_struct), PAGE_SIZE) / PAGE_SIZE + 1)
+#define VTASK_SCHED_PGOFF   (VTASK_VIEW_PGOFF + 1 + VTASK_TS_PAGES)
+#define VTASK_SCHED_PAGES   DIV_ROUND_UP(sizeof(struct vsched_data) + \
+                                         CONFIG_NR_CPUS * sizeof(struct vsched_cpu), PAGE_SIZE)
+#define VTASK_PSI_PGOFF     (VTASK_SCHED_PGOFF + VTASK_SCHED_PAGES)
+#define VTASK_DATA_PGOFF    (VTASK_PSI_PGOFF + 1)
+#define VTASK_SIZE          ((VTASK_DATA_PGOFF + 1) * PAGE_SIZE)
+
+/*
+ * 每线程 vtask 状态，由 vtask_register 创建，线程退出或 exec 时释放
+ */
+struct vtask_thread {
+    struct page *page;              /* 映射到用户态的 vtask_data 页 */
+    struct vtask_data *data;        /* page 的内核地址 */
+    unsigned long uaddr;            /* page 在用户态的地址 */
+    int slot;                       /* 在本进程 [vtask] 线程区中的页号 */
+    /* VTASK_SET_CS 设置的可重启区间, cs_end 为 0 表示没有 */
+    unsigned long cs_start;
+    unsigned long cs_end;
+    unsigned long cs_abort;
+#ifdef CONFIG_PREEMPT_NOTIFIERS
+    struct preempt_notifier notifier;   /* 调度进来时刷新 cpu */
+#endif
+};
+
+/* task_struct::vtask_pages 下标 */
+#define VTASK_PAGE_VIEW     0
+#define VTASK_PAGE_DATA     1
+#define VTASK_NR_PAGES      2
+
+struct pid;
+
+void vtask_release(struct task_struct *tsk, struct mm_struct *mm);
+int vtask_fork(struct task_struct *p, struct pid *pid);
+void vtask_free_pages(struct task_struct *tsk);
+
+#endif /* _LINUX_USER_TASKINFO_H */
@@ -0,0 +1,40 @@
+#ifndef _LINUX_XRING_H
+#define _LINUX_XRING_H
+
+#include <linux/list.h>
+#include <linux/wait.h>
+#include <uapi/linux/xring.h>
+
+struct task_struct;
+struct page;
+struct xring_worker;
+struct kv_store;
+
+/*
+ * 一个线程注册的 syscall ring，由 xring_setup 创建，线程退出、exec 或
+ * XRING_UNREGISTER 时释放
+ */
+struct xring {
+    struct task_struct *owner;      /* 请求以它的身份执行，持有引用 */
+    struct kv_store *kv;            /* owner 的共享 KV 存储，持有引用 */
+    struct xring_worker *worker;    /* 负责轮询的 per-CPU worker */
+    struct list_head node;          /* worker->rings */
+
+    struct page **pages;            /* pin 住的用户页 */
+    int nr_pages;
+    void *base;                     /* pages 的 vmap 地址 */
+    struct xring_hdr *hdr;
+    struct xring_sqe *sq;
+    struct xring_cqe *cq;
+    u32 mask;
+
+    /* 内核私有的下标，不信任用户写回的值 */
+    u32 sq_head;
+    u32 cq_tail;
+
+    wait_queue_head_t cq_wait;      /* XRING_ENTER_GETEVENTS */
+};
+
+void xring_release(struct task_struct *tsk);
+
+#endif /* _LINUX_XRING_H */
@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM vtask
+
+#if !defined(_TRACE_VTASK_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_VTASK_H
+
+#include <linux/mm_types.h>
+#include <linux/tracepoint.h>
+#include <linux/user_taskinfo.h>
+
+/*
+ * [vdso]/[vvar]/[vtask] 映射和缺页，实现在 arch/x86/entry/vdso/vma.c
+ *
+ *   echo 1 > /sys/kernel/tracing/events/vtask/enable
+ *   echo 'ret != 0' > /sys/kernel/tracing/events/vtask/vtask_map_vdso/filter
+ *
+ * pid/comm 由 trace 的公共字段记录，这里不重复。
+ */
+
+TRACE_EVENT(vtask_map_vdso,
+
+	TP_PROTO(unsigned long vtask_start, unsigned long vvar_start,
+		 unsigned long text_start, unsigned long vvar_size,
+		 unsigned long text_size, int ret, u64 duration_ns),
+
+	TP_ARGS(vtask_start, vvar_start, text_start, vvar_size, text_size,
+		ret, duration_ns),
+
+	TP_STRUCT__entry(
+		__field(unsigned long,	vtask_start)
+		__field(unsigned long,	vvar_start)
+		__field(unsigned long,	text_start)
+		__field(unsigned long,	vtask_size)
+		__field(unsigned long,	vvar_size)
+		__field(unsigned long,	text_size)
+		__field(int,		ret)
+		__field(u64,		duration_ns)
+	),
+
+	TP_fast_assign(
+		__entry->vtask_start	= vtask_start;
+		__entry->vvar_start	= vvar_start;
+		__entry->text_start	= text_start;
+		__entry->vtask_size	= VTASK_SIZE;
+		__entry->vvar_size	= vvar_size;
+		__entry->text_size	= text_size;
+		__entry->ret		= ret;
+		__entry->duration_ns	= duration_ns;
+	),
+
+	TP_printk("vtask=%lx+%lx vvar=%lx+%lx text=%lx+%lx ret=%d duration_ns=%llu",
+		  __entry->vtask_start, __entry->vtask_size,
+		  __entry->vvar_start, __entry->vvar_size,
+		  __entry->text_start, __entry->text_size,
+		  __entry->ret, __entry->duration_ns)
+);
+
+DECLARE_EVENT_CLASS(vtask_fault_class,
+
+	TP_PROTO(struct vm_area_struct *vma, struct vm_fault *vmf, vm_fault_t ret),
+
+	TP_ARGS(vma, vmf, ret),
+
+	TP_STRUCT__entry(
+		__field(unsigned long,	vm_start)
+		__field(unsigned long,	vm_end)
+		__field(unsigned long,	address)
+		__field(unsigned long,	pgoff)
+		__field(unsigned int,	ret)
+	),
+
+	TP_fast_assign(
+		__entry->vm_start	= vma->vm_start;
+		__entry->vm_end		= vma->vm_end;
+		__entry->address	= vmf->address;
+		__entry->pgoff		= vmf->pgoff;
+		__entry->ret		= ret;
+	),
+
+	TP_printk("vma=%lx-%lx address=%lx pgoff=%lu ret=%#x",
+		  __entry->vm_start, __entry->vm_end, __entry->address,
+		  __entry->pgoff, __entry->ret)
+);
+
+DEFINE_EVENT(vtask_fault_class, vtask_vvar_fault,
+	TP_PROTO(struct vm_area_struct *vma, struct vm_fault *vmf, vm_fault_t ret),
+	TP_ARGS(vma, vmf, ret)
+);
+
+DEFINE_EVENT(vtask_fault_class, vtask_fault,
+	TP_PROTO(struct vm_area_struct *vma, struct vm_fault *vmf, vm_fault_t ret),
+	TP_ARGS(vma, vmf, ret)
+);
+
+#endif /* _TRACE_VTASK_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
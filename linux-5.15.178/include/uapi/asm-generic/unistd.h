@@ -886,8 +886,35 @@ __SYSCALL(__NR_write_kv, sys_write_kv)
 #define __NR_read_kv 450
 __SYSCALL(__NR_read_kv, sys_read_kv)
 
+#define __NR_write_kv2 451
+__SYSCALL(__NR_write_kv2, sys_write_kv2)
+
+#define __NR_read_kv2 452
+__SYSCALL(__NR_read_kv2, sys_read_kv2)
+
+#define __NR_kv_dump 453
+__SYSCALL(__NR_kv_dump, sys_kv_dump)
+
+#define __NR_kv_load 454
+__SYSCALL(__NR_kv_load, sys_kv_load)
+
+#define __NR_vtask_register 455
+__SYSCALL(__NR_vtask_register, sys_vtask_register)
+
+#define __NR_xring_setup 456
+__SYSCALL(__NR_xring_setup, sys_xring_setup)
+
+#define __NR_xring_enter 457
+__SYSCALL(__NR_xring_enter, sys_xring_enter)
+
+#define __NR_multicall 458
+__SYSCALL(__NR_multicall, sys_multicall)
+
+#define __NR_vpercpu_setup 459
+__SYSCALL(__NR_vpercpu_setup, sys_vpercpu_setup)
+
 #undef __NR_syscalls
-#define __NR_syscalls 451
+#define __NR_syscalls 460
 
 /*
  * 32 bit systems traditionally used different
@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_KV_STORE_H
+#define _UAPI_LINUX_KV_STORE_H
+
+#include <linux/types.h>
+
+/*
+ * flags for write_kv2 / read_kv2
+ */
+#define KV_PRIVATE	0x1	/* use the calling thread's private store (no locking) */
+
+#define KV_FLAGS_MASK	(KV_PRIVATE)
+
+/*
+ * kv_dump / kv_load file format:
+ * one struct kv_dump_header followed by struct kv_dump_record until EOF
+ */
+#define KV_DUMP_MAGIC	0x3153564b	/* "KVS1" */
+#define KV_DUMP_VERSION	1
+
+struct kv_dump_header {
+	__u32 magic;
+	__u32 version;
+};
+
+struct kv_dump_record {
+	__s32 key;
+	__s32 value;
+};
+
+#endif /* _UAPI_LINUX_KV_STORE_H */
@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_MULTICALL_H
+#define _UAPI_LINUX_MULTICALL_H
+
+#include <linux/types.h>
+
+/*
+ * multicall(vec, n, flags) runs vec[0..n) in order in a single kernel
+ * entry and stores each return value in vec[i].result. Only whitelisted
+ * syscalls are allowed (KV store, xattr reads, socket options and
+ * configure_socket_fairness); anything else gets -EINVAL in its result.
+ *
+ * Each entry is checked against the caller's seccomp filter as if it had
+ * been issued on its own (nr, arch and args of the entry, the multicall's
+ * instruction pointer); a denied entry gets the filter's errno (or -EPERM)
+ * in its result and the vector continues. KILL and TRAP act on the whole
+ * task as usual. Filters using SECCOMP_RET_TRACE hand the tracer the
+ * multicall's registers, not the entry's, so such sandboxes should deny
+ * multicall itself. Each entry also fires the raw_syscalls sys_enter/
+ * sys_exit tracepoints and, for audited tasks, adds one AUDIT_KERNEL_OTHER
+ * record to the multicall event. PTRACE_SYSCALL stops only on multicall.
+ *
+ * Returns the number of entries that were executed. With
+ * MULTICALL_STOP_ON_ERROR execution stops after the first entry whose
+ * result is an error (-4095..-1); note that read_kv reports a missing
+ * key as -1.
+ */
+#define MULTICALL_MAX		64
+
+#define MULTICALL_STOP_ON_ERROR	0x1
+#define MULTICALL_FLAGS_MASK	(MULTICALL_STOP_ON_ERROR)
+
+struct multicall_entry {
+	__u32 nr;		/* syscall number */
+	__u32 flags;		/* must be 0 */
+	__u64 args[6];
+	__s64 result;		/* filled in by the kernel */
+};
+
+#endif /* _UAPI_LINUX_MULTICALL_H */
@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_VTASK_H
+#define _UAPI_LINUX_VTASK_H
+
+#include <linux/types.h>
+
+/*
+ * Stable per-task data page exported through the [vtask] mapping.
+ *
+ * Unlike the raw task_struct view, the layout of this struct is ABI:
+ * fields are only ever appended and VTASK_DATA_VERSION is bumped when
+ * that happens. Readers must retry while @seq is odd or has changed.
+ */
+#define VTASK_DATA_VERSION	2
+
+struct vtask_data {
+	__u32 version;		/* VTASK_DATA_VERSION */
+	__u32 seq;		/* seqcount, odd while the kernel is updating */
+	__u64 generation;	/* changes every time the page is (re)populated, e.g. after fork */
+	__s32 pid;		/* process id, what getpid() returns (kernel tgid) */
+	__s32 tid;		/* thread id of the owner, what gettid() returns (kernel pid) */
+	__u32 cpu;		/* CPU the owner runs on */
+	__u32 node;		/* NUMA node of @cpu */
+	/* version 2, only maintained in per-thread pages: */
+	__u64 sum_exec_runtime;	/* owner's CPU time in ns when it was last scheduled in */
+	__u64 switch_tsc;	/* TSC when the owner was last scheduled in */
+};
+
+/*
+ * vtask_register(flags) maps a vtask_data page private to the calling
+ * thread and returns its address; the thread keeps it in TLS, much like
+ * an rseq area. @cpu/@node of that page follow the thread across
+ * migrations. The page goes away on thread exit, exec or
+ * vtask_register(VTASK_UNREGISTER).
+ */
+#define VTASK_UNREGISTER	0x1
+
+/*
+ * vtask_register(VTASK_SET_CS, cs) gives the calling (registered) thread
+ * one restartable region: whenever the thread is scheduled in, or has a
+ * signal delivered, while its user IP is in [start_ip, post_commit_ip),
+ * it resumes at abort_ip instead (for a signal: once the handler returns).
+ * If the region ends with a single committing instruction it can use @cpu
+ * of the per-thread page to update per-CPU data without atomics, like an
+ * rseq critical section. cs == NULL clears the region.
+ */
+#define VTASK_SET_CS		0x2
+
+struct vtask_cs {
+	__u64 start_ip;
+	__u64 post_commit_ip;
+	__u64 abort_ip;		/* must be outside the region */
+};
+
+/*
+ * vpercpu_setup(size, flags) maps a writable area shared by the threads of
+ * the calling process, with one slot of PAGE_ALIGN(size) bytes for each
+ * possible CPU (vsched_data::nr_cpus of them), and returns its address.
+ * All pages are allocated zeroed by the call itself, on the node of the
+ * slot's CPU, and charged to the caller's memory cgroup (-ENOMEM if that
+ * fails). Slots of CPU ids that are not possible are left unpopulated;
+ * touching them, or a page dropped later by madvise(MADV_DONTNEED) and
+ * the like, raises SIGBUS. The area is not inherited across fork; there
+ * is at most one per process (-EEXIST) and munmap() removes it. @flags
+ * must be 0.
+ */
+#define VPERCPU_MAX_SIZE	(64 * 1024)
+
+/*
+ * System-wide scheduler load hints, shared read-only by every process
+ * through the [vtask] mapping. Each field is a single word updated by the
+ * scheduler as runqueues change; the page is a hint, not a consistent
+ * snapshot, so readers need no retry loop. Every CPU has its own cache
+ * line so that runqueue updates on different CPUs never share a line.
+ */
+#define VSCHED_DATA_VERSION	1
+
+struct vsched_cpu {
+	__u32 nr_running;	/* tasks on this CPU's runqueue, 0 when idle */
+	__u32 __pad[15];
+};
+
+struct vsched_data {
+	__u32 version;		/* VSCHED_DATA_VERSION */
+	__u32 nr_cpus;		/* number of valid entries in @cpus (nr_cpu_ids) */
+	__u32 nr_idle;		/* online CPUs with an empty runqueue */
+	__u32 __pad[13];
+	struct vsched_cpu cpus[];
+};
+
+/*
+ * System-wide memory pressure (the "memory" line of /proc/pressure),
+ * shared read-only through the [vtask] mapping and refreshed every
+ * VPSI_PERIOD_MS. Readers retry while @seq is odd or has changed.
+ * @events counts refreshes that saw new memory stall time, so checking
+ * for pressure since the last look is a single load and compare.
+ */
+#define VPSI_DATA_VERSION	1
+#define VPSI_PERIOD_MS		500
+
+struct vpsi_data {
+	__u32 version;		/* VPSI_DATA_VERSION */
+	__u32 seq;		/* seqcount, odd while the kernel is updating */
+	__u64 events;		/* refreshes that observed new "some" stall time */
+	__u64 update_ns;	/* CLOCK_MONOTONIC time of the last refresh */
+	__u32 some_avg[3];	/* avg10/avg60/avg300 in hundredths of a percent */
+	__u32 full_avg[3];
+	__u64 some_total;	/* cumulative stall time in us */
+	__u64 full_total;
+};
+
+/* __vdso_sched_hint() result */
+struct vsched_hint {
+	__u32 cpu;		/* CPU the caller runs on */
+	__u32 node;		/* NUMA node of @cpu */
+	__u32 nr_cpus;		/* see struct vsched_data */
+	__u32 nr_idle;
+	__u32 nr_running;	/* runqueue length of @cpu, including the caller */
+};
+
+#endif /* _UAPI_LINUX_VTASK_H */
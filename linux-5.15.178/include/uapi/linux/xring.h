@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_XRING_H
+#define _UAPI_LINUX_XRING_H
+
+#include <linux/types.h>
+
+/*
+ * Exception-less syscall ring.
+ *
+ * A thread allocates a page-aligned buffer of XRING_SIZE(entries) bytes
+ * and registers it with xring_setup(). It then queues requests by
+ * filling sq[sq_tail & (entries - 1)] and advancing sq_tail (release).
+ * A per-CPU kernel worker picks them up, runs them on behalf of the
+ * thread and posts one cqe per sqe at cq[cq_tail & (entries - 1)]. No
+ * trap is taken per call.
+ *
+ * The worker polls for a while after the last request and then goes to
+ * sleep, setting XRING_NEED_WAKEUP first. A producer that sees the flag
+ * after advancing sq_tail (full barrier in between) must call
+ * xring_enter(0, XRING_ENTER_WAKEUP). xring_enter(n, XRING_ENTER_GETEVENTS)
+ * blocks until at least n completions are available.
+ */
+
+/* opcodes */
+enum {
+	XRING_OP_NOP,			/* no args, res = 0 */
+	XRING_OP_WRITE_KV,		/* args: key, value */
+	XRING_OP_READ_KV,		/* args: key */
+	XRING_OP_SOCKET_FAIRNESS,	/* args: thread_id, max_socket_allowed */
+	XRING_OP_LAST,
+};
+
+struct xring_sqe {
+	__u32 opcode;
+	__u32 flags;			/* must be 0 */
+	__u64 user_data;		/* copied into the cqe */
+	__s64 args[4];
+};
+
+struct xring_cqe {
+	__u64 user_data;
+	__s64 res;			/* syscall return value, -errno on failure */
+};
+
+/* xring_hdr::flags, written by the kernel */
+#define XRING_NEED_WAKEUP	(1U << 0)
+
+/* Each index sits on its own cache line: producer and consumer never share one */
+struct xring_hdr {
+	__u32 sq_head;			/* kernel consumes sqes */
+	__u32 __pad0[15];
+	__u32 sq_tail;			/* user produces sqes */
+	__u32 __pad1[15];
+	__u32 cq_head;			/* user consumes cqes */
+	__u32 __pad2[15];
+	__u32 cq_tail;			/* kernel produces cqes */
+	__u32 flags;
+	__u32 entries;			/* filled in by xring_setup */
+	__u32 __pad3[13];
+};
+
+#define XRING_SQ_OFF		sizeof(struct xring_hdr)
+#define XRING_CQ_OFF(n)		(XRING_SQ_OFF + (n) * sizeof(struct xring_sqe))
+#define XRING_SIZE(n)		(XRING_CQ_OFF(n) + (n) * sizeof(struct xring_cqe))
+#define XRING_MAX_ENTRIES	4096
+
+struct xring_params {
+	__u32 entries;			/* power of two, <= XRING_MAX_ENTRIES */
+	__u32 flags;			/* XRING_SETUP_* */
+	__s32 cpu;			/* worker CPU with XRING_SETUP_CPU; must be in
+					 * the caller's affinity mask unless it has
+					 * CAP_SYS_NICE, else -EPERM */
+	__u32 resv[5];
+};
+
+/* xring_setup flags */
+#define XRING_SETUP_CPU		(1U << 0)	/* serve from params.cpu, default: current CPU */
+#define XRING_UNREGISTER	(1U << 1)	/* drop the calling thread's ring */
+
+/* xring_enter flags */
+#define XRING_ENTER_WAKEUP	(1U << 0)
+#define XRING_ENTER_GETEVENTS	(1U << 1)
+
+#endif /* _UAPI_LINUX_XRING_H */
@@ -112,6 +112,11 @@
 
 /* kv_init */
 int init_task_kv_store(struct task_struct *task);
+void kv_store_get(struct kv_store *kv);
+void kv_store_put(struct kv_store *kv);
+
+#include <linux/user_taskinfo.h>
+#include <linux/xring.h>
 
 /*p
  * Minimum number of threads to boot the kernel
@@ -455,6 +460,7 @@ void free_task(struct task_struct *tsk)
 #endif
 	release_user_cpus_ptr(tsk);
 	scs_release(tsk);
+	vtask_free_pages(tsk);
 
 #ifndef CONFIG_THREAD_INFO_IN_TASK
 	/*
@@ -1399,6 +1405,11 @@ static void mm_release(struct task_struct *tsk, struct mm_struct *mm)
 {
 	uprobe_free_utask(tsk);
 
+	/* Drop the per-thread vtask page while the mm is still ours */
+	vtask_release(tsk, mm);
+	/* The syscall ring lives in this mm, stop serving it */
+	xring_release(tsk);
+
 	/* Get rid of any cached register state */
 	deactivate_mm(tsk, mm);
 
@@ -2060,6 +2071,12 @@ static __latent_entropy struct task_struct *copy_process(
 	 */
 	p->clear_child_tid = (clone_flags & CLONE_CHILD_CLEARTID) ? args->child_tid : NULL;
 
+	/*
+	 * The cached [vtask] pages are the parent's, drop the copied
+	 * pointers before any bad_fork_* path reaches free_task().
+	 */
+	memset(p->vtask_pages, 0, sizeof(p->vtask_pages));
+
 	ftrace_graph_init_task(p);
 
 	rt_mutex_init_task(p);
@@ -2263,9 +2280,16 @@ static __latent_entropy struct task_struct *copy_process(
 	/* init kv_store */
 	if (clone_flags & CLONE_THREAD) { /* new thread */
 		p->kv = current->kv;
+		if (p->kv)
+			kv_store_get(p->kv);
 	} else { /* new process */
 		init_task_kv_store(p);
 	}
+	/* private store belongs to a single thread, never inherited */
+	p->kv_private = NULL;
+	/* per-thread vtask page is set up by vtask_register */
+	p->vtask = NULL;
+	p->xring = NULL;
 
 	/*
 	 * sigaltstack should be cleared when sharing the same VM
@@ -2294,6 +2318,16 @@ static __latent_entropy struct task_struct *copy_process(
 		p->tgid = p->pid;
 	}
 
+	/*
+	 * a new mm gets its own [vtask] view/data pages up front; p->pid and
+	 * p->tgid must already be set, vtask_populate() copies them
+	 */
+	if (p->mm && !(clone_flags & CLONE_VM)) {
+		retval = vtask_fork(p, pid);
+		if (retval)
+			goto bad_fork_cleanup_kv;
+	}
+
 	p->nr_dirtied = 0;
 	p->nr_dirtied_pause = 128 >> (PAGE_SHIFT - 10);
 	p->dirty_paused_when = 0;
@@ -2315,7 +2349,7 @@ static __latent_entropy struct task_struct *copy_process(
 	 */
 	retval = cgroup_can_fork(p, args);
 	if (retval)
-		goto bad_fork_put_pidfd;
+		goto bad_fork_cleanup_kv;
 
 	/*
 	 * Now that the cgroups are pinned, re-clone the parent cgroup and put
@@ -2455,6 +2489,10 @@ bad_fork_cancel_cgroup:
 	spin_unlock(&current->sighand->siglock);
 	write_unlock_irq(&tasklist_lock);
 	cgroup_cancel_fork(p, args);
+bad_fork_cleanup_kv:
+	/* drops the thread's reference, or frees a new process's empty store */
+	kv_store_put(p->kv);
+	p->kv = NULL;
 bad_fork_put_pidfd:
 	if (clone_flags & CLONE_PIDFD) {
 		fput(pidfile);
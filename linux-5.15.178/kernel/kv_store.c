@@ -4,6 +4,8 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/audit.h>
+#include <linux/debugfs.h>
 #include <linux/sched.h>
 #include <linux/syscalls.h>
 #include <linux/spinlock.h>
@@ -11,6 +13,31 @@
 #include <linux/slab.h>
 #include <linux/sched/task.h>
 #include <linux/sched/signal.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/nospec.h>
+#include <linux/percpu.h>
+#include <linux/pid.h>
+#include <linux/seccomp.h>
+#include <linux/seq_file.h>
+#include <linux/sysprof.h>
+#include <linux/vmalloc.h>
+#include <linux/xring.h>
+#include <linux/unistd.h>
+#include <asm/syscall.h>
+#include <trace/events/syscalls.h>
+#ifdef CONFIG_SOCKET_FAIR
+#include <linux/socket_fair.h>
+#endif
+#include <uapi/linux/kv_store.h>
+#include <uapi/linux/multicall.h>
 
 // define the kv_node struct
 struct kv_node {
@@ -19,90 +46,1166 @@ struct kv_node {
     struct hlist_node node;
 };
 
-// asmlinkage long sys_write_kv(int k, int v); 449
-SYSCALL_DEFINE2(write_kv, int, k, int, v)
+static struct kv_node *kv_lookup(struct hlist_head *head, int k)
 {
-    struct kv_node *entry, *old_entry = NULL;
-    unsigned int hash = k & 1023; // k % 1024
+    struct kv_node *entry;
+
+    hlist_for_each_entry(entry, head, node) {
+        if (entry->key == k)
+            return entry;
+    }
+    return NULL;
+}
 
-    // get current task
-    struct task_struct *task = current;
+/*
+ * @ps is non-NULL only for a sampled write_kv/read_kv syscall, see
+ * include/linux/sysprof.h; every other caller goes through the wrappers
+ * below with NULL and the marks compile away.
+ */
+static __always_inline long __kv_shared_write(struct kv_store *kv, int k, int v,
+                                              struct sysprof_sample *ps)
+{
+    struct kv_node *entry, *new_entry = NULL;
+    unsigned int hash = k & 1023; // k % 1024
 
-    spin_lock(&task->kv->locks[hash]);
+    sysprof_mark(ps, SYSPROF_ENTRY);
+    spin_lock(&kv->locks[hash]);
+    sysprof_mark(ps, SYSPROF_LOCK);
 
-    hlist_for_each_entry(entry, &task->kv->head[hash], node) {
-        if (entry->key == k) {
-            old_entry = entry;
-            break;
-        }
+    entry = kv_lookup(&kv->head[hash], k);
+    if (entry == NULL) {
+        // kmalloc(GFP_KERNEL) may sleep, allocate outside the lock and retry
+        spin_unlock(&kv->locks[hash]);
+        new_entry = kmalloc(sizeof(struct kv_node), GFP_KERNEL);
+        if (!new_entry)
+            return -1; // memory allocation failed
+        sysprof_mark(ps, SYSPROF_WORK);
+        spin_lock(&kv->locks[hash]);
+        sysprof_mark(ps, SYSPROF_LOCK);
+        entry = kv_lookup(&kv->head[hash], k);
     }
 
-    if (old_entry != NULL) {
+    if (entry != NULL) {
         // update the value
-        old_entry->value = v;
+        entry->value = v;
     } else {
         // create a new entry
-        entry = kmalloc(sizeof(struct kv_node), GFP_KERNEL);
-        if (!entry) {
-            spin_unlock(&task->kv->locks[hash]);
-            return -1; // memory allocation failed
-        }
+        new_entry->key = k;
+        new_entry->value = v;
+        hlist_add_head(&new_entry->node, &kv->head[hash]);
+        new_entry = NULL;
+    }
+    spin_unlock(&kv->locks[hash]);
+    sysprof_mark(ps, SYSPROF_WORK);
 
-        entry->key = k;
+    kfree(new_entry);
+    return sizeof(int);
+}
+
+static __always_inline long __kv_shared_read(struct kv_store *kv, int k,
+                                             struct sysprof_sample *ps)
+{
+    struct kv_node *entry;
+    int ret = -1;
+    unsigned int hash = k & 1023; // k % 1024
+
+    sysprof_mark(ps, SYSPROF_ENTRY);
+    spin_lock(&kv->locks[hash]);
+    sysprof_mark(ps, SYSPROF_LOCK);
+    entry = kv_lookup(&kv->head[hash], k);
+    if (entry != NULL)
+        ret = entry->value;
+    spin_unlock(&kv->locks[hash]);
+    sysprof_mark(ps, SYSPROF_WORK);
+    return ret;
+}
+
+static long kv_shared_write(struct kv_store *kv, int k, int v)
+{
+    return __kv_shared_write(kv, k, v, NULL);
+}
+
+static long kv_shared_read(struct kv_store *kv, int k)
+{
+    return __kv_shared_read(kv, k, NULL);
+}
+
+/*
+ * Thread-private store: only current ever touches current->kv_private
+ * (it is not inherited by clone and is freed by the owner on exit), so
+ * no locks or atomics are needed on this path.
+ */
+static long kv_private_write(struct task_struct *task, int k, int v)
+{
+    struct kv_private_store *kv = task->kv_private;
+    struct kv_node *entry;
+    unsigned int hash = k & 1023; // k % 1024
+    int i;
+
+    if (unlikely(!kv)) {
+        kv = kmalloc(sizeof(struct kv_private_store), GFP_KERNEL);
+        if (!kv)
+            return -1;
+        for (i = 0; i < 1024; i++)
+            INIT_HLIST_HEAD(&kv->head[i]);
+        task->kv_private = kv;
+    }
+
+    entry = kv_lookup(&kv->head[hash], k);
+    if (entry != NULL) {
         entry->value = v;
-        hlist_add_head(&entry->node, &task->kv->head[hash]);
+        return sizeof(int);
     }
-    spin_unlock(&task->kv->locks[hash]);
+
+    entry = kmalloc(sizeof(struct kv_node), GFP_KERNEL);
+    if (!entry)
+        return -1;
+    entry->key = k;
+    entry->value = v;
+    hlist_add_head(&entry->node, &kv->head[hash]);
     return sizeof(int);
 }
 
+static long kv_private_read(struct task_struct *task, int k)
+{
+    struct kv_private_store *kv = task->kv_private;
+    struct kv_node *entry;
+
+    if (!kv)
+        return -1;
+
+    entry = kv_lookup(&kv->head[k & 1023], k);
+    return entry ? entry->value : -1;
+}
+
+// asmlinkage long sys_write_kv(int k, int v); 449
+SYSCALL_DEFINE2(write_kv, int, k, int, v)
+{
+    struct sysprof_sample ps;
+    long ret;
+
+    if (sysprof_begin(&ps)) {
+        ret = __kv_shared_write(current->kv, k, v, &ps);
+        sysprof_end(&ps, SYSPROF_WRITE_KV);
+        return ret;
+    }
+    return kv_shared_write(current->kv, k, v);
+}
+
 
 // asmlinkage long sys_read_kv(int k); 450
 SYSCALL_DEFINE1(read_kv, int, k)
 {
+    struct sysprof_sample ps;
+    long ret;
+
+    if (sysprof_begin(&ps)) {
+        ret = __kv_shared_read(current->kv, k, &ps);
+        sysprof_end(&ps, SYSPROF_READ_KV);
+        return ret;
+    }
+    return kv_shared_read(current->kv, k);
+}
+
+// asmlinkage long sys_write_kv2(int k, int v, unsigned int flags); 451
+SYSCALL_DEFINE3(write_kv2, int, k, int, v, unsigned int, flags)
+{
+    if (flags & ~KV_FLAGS_MASK)
+        return -EINVAL;
+
+    if (flags & KV_PRIVATE)
+        return kv_private_write(current, k, v);
+    return kv_shared_write(current->kv, k, v);
+}
+
+// asmlinkage long sys_read_kv2(int k, unsigned int flags); 452
+SYSCALL_DEFINE2(read_kv2, int, k, unsigned int, flags)
+{
+    if (flags & ~KV_FLAGS_MASK)
+        return -EINVAL;
+
+    if (flags & KV_PRIVATE)
+        return kv_private_read(current, k);
+    return kv_shared_read(current->kv, k);
+}
+
+#define KV_DUMP_BATCH   (PAGE_SIZE / sizeof(struct kv_dump_record))
+
+static int kv_dump_flush(struct file *file, struct kv_dump_record *buf, size_t n)
+{
+    size_t len = n * sizeof(*buf);
+    ssize_t ret;
+
+    if (!n)
+        return 0;
+    ret = kernel_write(file, buf, len, &file->f_pos);
+    if (ret < 0)
+        return ret;
+    return ret == len ? 0 : -EIO;
+}
+
+/*
+ * Copy bucket @i into @buf[used..cap) under its lock.
+ * Returns the number of records copied, or -ENOSPC if the bucket does not fit.
+ */
+static long kv_dump_bucket(struct task_struct *task, unsigned int flags, int i,
+                           struct kv_dump_record *buf, size_t used, size_t cap)
+{
+    struct hlist_head *head;
     struct kv_node *entry;
-    int ret = -1;
-    unsigned int hash = k & 1023; // k % 1024
+    long n = 0;
 
-    // get current task
-    struct task_struct *task = current;
+    if (flags & KV_PRIVATE) {
+        // owner thread only, nothing to lock
+        if (!task->kv_private)
+            return 0;
+        head = &task->kv_private->head[i];
+    } else {
+        head = &task->kv->head[i];
+        spin_lock(&task->kv->locks[i]);
+    }
 
-    spin_lock(&task->kv->locks[hash]);
+    hlist_for_each_entry(entry, head, node) {
+        if (used + n >= cap) {
+            n = -ENOSPC;
+            break;
+        }
+        buf[used + n].key = entry->key;
+        buf[used + n].value = entry->value;
+        n++;
+    }
 
-    hlist_for_each_entry(entry, &task->kv->head[hash], node) {
-        if (entry->key == k) {
-            ret = entry->value;
+    if (!(flags & KV_PRIVATE))
+        spin_unlock(&task->kv->locks[i]);
+    return n;
+}
+
+// asmlinkage long sys_kv_dump(int fd, unsigned int flags); 453
+SYSCALL_DEFINE2(kv_dump, int, fd, unsigned int, flags)
+{
+    struct kv_dump_header hdr = {
+        .magic = KV_DUMP_MAGIC,
+        .version = KV_DUMP_VERSION,
+    };
+    struct kv_dump_record *buf;
+    size_t cap = KV_DUMP_BATCH, used = 0;
+    long total = 0, n;
+    struct fd f;
+    int i, ret;
+
+    if (flags & ~KV_FLAGS_MASK)
+        return -EINVAL;
+
+    f = fdget_pos(fd);
+    if (!f.file)
+        return -EBADF;
+
+    buf = kvmalloc_array(cap, sizeof(*buf), GFP_KERNEL);
+    if (!buf) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    ret = kernel_write(f.file, &hdr, sizeof(hdr), &f.file->f_pos);
+    if (ret != sizeof(hdr)) {
+        ret = ret < 0 ? ret : -EIO;
+        goto out_free;
+    }
+
+    // lock one bucket at a time, write to the file with no lock held
+    for (i = 0; i < 1024; ) {
+        n = kv_dump_bucket(current, flags, i, buf, used, cap);
+        if (n >= 0) {
+            used += n;
+            i++;
+            continue;
+        }
+
+        if (used == 0) {
+            // a single bucket larger than the buffer, grow it
+            kvfree(buf);
+            cap *= 2;
+            buf = kvmalloc_array(cap, sizeof(*buf), GFP_KERNEL);
+            if (!buf) {
+                ret = -ENOMEM;
+                goto out;
+            }
+            continue;
+        }
+
+        ret = kv_dump_flush(f.file, buf, used);
+        if (ret)
+            goto out_free;
+        total += used;
+        used = 0;
+    }
+
+    ret = kv_dump_flush(f.file, buf, used);
+    if (ret)
+        goto out_free;
+    total += used;
+
+out_free:
+    kvfree(buf);
+out:
+    fdput_pos(f);
+    return ret ? ret : total;
+}
+
+// asmlinkage long sys_kv_load(int fd, unsigned int flags); 454
+SYSCALL_DEFINE2(kv_load, int, fd, unsigned int, flags)
+{
+    struct kv_dump_header hdr;
+    struct kv_dump_record *buf;
+    size_t carry = 0, i, n;
+    long total = 0, ret;
+    struct fd f;
+
+    if (flags & ~KV_FLAGS_MASK)
+        return -EINVAL;
+
+    f = fdget_pos(fd);
+    if (!f.file)
+        return -EBADF;
+
+    ret = kernel_read(f.file, &hdr, sizeof(hdr), &f.file->f_pos);
+    if (ret != sizeof(hdr)) {
+        ret = ret < 0 ? ret : -EINVAL;
+        goto out;
+    }
+    if (hdr.magic != KV_DUMP_MAGIC || hdr.version != KV_DUMP_VERSION) {
+        ret = -EINVAL;
+        goto out;
+    }
+
+    buf = kvmalloc_array(KV_DUMP_BATCH, sizeof(*buf), GFP_KERNEL);
+    if (!buf) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    for (;;) {
+        ret = kernel_read(f.file, (char *)buf + carry,
+                          KV_DUMP_BATCH * sizeof(*buf) - carry, &f.file->f_pos);
+        if (ret < 0)
+            break;
+        if (ret == 0) {
+            // truncated record at end of file
+            ret = carry ? -EINVAL : 0;
+            break;
+        }
+
+        carry += ret;
+        n = carry / sizeof(*buf);
+        for (i = 0; i < n; i++) {
+            if (flags & KV_PRIVATE)
+                ret = kv_private_write(current, buf[i].key, buf[i].value);
+            else
+                ret = kv_shared_write(current->kv, buf[i].key, buf[i].value);
+            if (ret < 0) {
+                ret = -ENOMEM;
+                goto out_free;
+            }
+        }
+        total += n;
+
+        carry -= n * sizeof(*buf);
+        memmove(buf, (char *)buf + n * sizeof(*buf), carry);
+    }
+
+out_free:
+    kvfree(buf);
+out:
+    fdput_pos(f);
+    return ret < 0 ? ret : total;
+}
+
+/*
+ * Exception-less syscall ring, see include/uapi/linux/xring.h
+ *
+ * One kthread per CPU serves every ring registered on that CPU. It runs
+ * requests as they arrive and keeps polling for xring_poll_us after the
+ * last one; then it sets XRING_NEED_WAKEUP on its rings and sleeps until
+ * a producer calls xring_enter(XRING_ENTER_WAKEUP), so idle rings cost
+ * nothing.
+ */
+static unsigned int xring_poll_us = 50;
+module_param(xring_poll_us, uint, 0644);
+MODULE_PARM_DESC(xring_poll_us, "how long an xring worker polls after the last request");
+
+struct xring_worker {
+    struct task_struct *task;
+    struct mutex lock;          /* protects rings, held while serving them */
+    struct list_head rings;
+    bool woken;
+};
+
+static DEFINE_MUTEX(xring_workers_lock);
+static DEFINE_PER_CPU(struct xring_worker *, xring_worker);
+
+typedef long (*xring_op_fn)(struct xring *r, const struct xring_sqe *sqe);
+
+static long xring_op_nop(struct xring *r, const struct xring_sqe *sqe)
+{
+    return 0;
+}
+
+// requests run in the worker, so they act on the owner's store, not current's
+static long xring_op_write_kv(struct xring *r, const struct xring_sqe *sqe)
+{
+    return kv_shared_write(r->kv, (int)sqe->args[0], (int)sqe->args[1]);
+}
+
+static long xring_op_read_kv(struct xring *r, const struct xring_sqe *sqe)
+{
+    return kv_shared_read(r->kv, (int)sqe->args[0]);
+}
+
+static long xring_op_socket_fairness(struct xring *r, const struct xring_sqe *sqe)
+{
+#ifdef CONFIG_SOCKET_FAIR
+    struct pid *pid;
+    pid_t nr = 0;
+
+    // thread_id is in the owner's pid namespace, the worker lives in init_pid_ns
+    rcu_read_lock();
+    pid = find_pid_ns((pid_t)sqe->args[0], task_active_pid_ns(r->owner));
+    if (pid)
+        nr = pid_nr(pid);
+    rcu_read_unlock();
+    if (!nr)
+        return -ESRCH;
+    return socket_fairness_configure(nr, (int)sqe->args[1]);
+#else
+    return -ENOSYS;
+#endif
+}
+
+static const xring_op_fn xring_ops[XRING_OP_LAST] = {
+    [XRING_OP_NOP]              = xring_op_nop,
+    [XRING_OP_WRITE_KV]         = xring_op_write_kv,
+    [XRING_OP_READ_KV]          = xring_op_read_kv,
+    [XRING_OP_SOCKET_FAIRNESS]  = xring_op_socket_fairness,
+};
+
+static bool xring_sq_pending(struct xring *r)
+{
+    return r->sq_head != READ_ONCE(r->hdr->sq_tail);
+}
+
+/*
+ * Run the queued requests of one ring, at most one ring's worth per pass
+ * so a busy ring cannot starve the others on this worker.
+ */
+static unsigned int xring_serve(struct xring *r)
+{
+    struct xring_hdr *hdr = r->hdr;
+    u32 tail = smp_load_acquire(&hdr->sq_tail);
+    unsigned int done = 0;
+
+    while (r->sq_head != tail && done <= r->mask) {
+        struct xring_sqe sqe;
+        struct xring_cqe *cqe;
+        long res;
+
+        // no room for the completion: wait for the user to consume some
+        if (r->cq_tail - READ_ONCE(hdr->cq_head) > r->mask)
             break;
+
+        // copy first, the user can rewrite the slot at any time
+        sqe = r->sq[r->sq_head & r->mask];
+        if (sqe.opcode >= XRING_OP_LAST || sqe.flags)
+            res = -EINVAL;
+        else
+            res = xring_ops[array_index_nospec(sqe.opcode, XRING_OP_LAST)](r, &sqe);
+
+        cqe = &r->cq[r->cq_tail & r->mask];
+        cqe->user_data = sqe.user_data;
+        cqe->res = res;
+        r->sq_head++;
+        r->cq_tail++;
+        smp_store_release(&hdr->cq_tail, r->cq_tail);
+        done++;
+    }
+
+    if (done) {
+        smp_store_release(&hdr->sq_head, r->sq_head);
+        if (wq_has_sleeper(&r->cq_wait))
+            wake_up(&r->cq_wait);
+    }
+    return done;
+}
+
+static void xring_set_need_wakeup(struct xring_worker *w, bool on)
+{
+    struct xring *r;
+
+    list_for_each_entry(r, &w->rings, node) {
+        u32 flags = READ_ONCE(r->hdr->flags);
+
+        WRITE_ONCE(r->hdr->flags, on ? flags | XRING_NEED_WAKEUP : flags & ~XRING_NEED_WAKEUP);
+    }
+}
+
+static int xring_worker_fn(void *data)
+{
+    struct xring_worker *w = data;
+    u64 last = ktime_get_ns();
+    struct xring *r;
+
+    while (!kthread_should_stop()) {
+        unsigned int done = 0;
+        bool pending = false;
+
+        mutex_lock(&w->lock);
+        list_for_each_entry(r, &w->rings, node)
+            done += xring_serve(r);
+        mutex_unlock(&w->lock);
+
+        if (done)
+            last = ktime_get_ns();
+        if (done || ktime_get_ns() - last < (u64)READ_ONCE(xring_poll_us) * NSEC_PER_USEC) {
+            cond_resched();
+            continue;
         }
+
+        // announce that we are going to sleep, then look again so that a
+        // producer that missed the flag cannot be left waiting
+        mutex_lock(&w->lock);
+        xring_set_need_wakeup(w, true);
+        smp_mb();
+        list_for_each_entry(r, &w->rings, node)
+            pending |= xring_sq_pending(r);
+        mutex_unlock(&w->lock);
+
+        if (!pending) {
+            set_current_state(TASK_INTERRUPTIBLE);
+            if (!READ_ONCE(w->woken) && !kthread_should_stop())
+                schedule();
+            __set_current_state(TASK_RUNNING);
+        }
+        WRITE_ONCE(w->woken, false);
+
+        mutex_lock(&w->lock);
+        xring_set_need_wakeup(w, false);
+        mutex_unlock(&w->lock);
+        last = ktime_get_ns();
     }
+    return 0;
+}
 
-    spin_unlock(&task->kv->locks[hash]);
+static void xring_wake_worker(struct xring_worker *w)
+{
+    WRITE_ONCE(w->woken, true);
+    wake_up_process(w->task);
+}
+
+// workers are created on first use and stay around
+static struct xring_worker *xring_get_worker(int cpu)
+{
+    struct xring_worker *w;
+
+    mutex_lock(&xring_workers_lock);
+    w = per_cpu(xring_worker, cpu);
+    if (w)
+        goto out;
+
+    w = kzalloc(sizeof(*w), GFP_KERNEL);
+    if (!w)
+        goto out;
+    mutex_init(&w->lock);
+    INIT_LIST_HEAD(&w->rings);
+    w->task = kthread_create_on_cpu(xring_worker_fn, w, cpu, "xring/%u");
+    if (IS_ERR(w->task)) {
+        kfree(w);
+        w = NULL;
+        goto out;
+    }
+    per_cpu(xring_worker, cpu) = w;
+    wake_up_process(w->task);
+out:
+    mutex_unlock(&xring_workers_lock);
+    return w;
+}
+
+static long xring_register(void __user *uring, const struct xring_params *p)
+{
+    unsigned int n = p->entries;
+    struct xring_worker *w;
+    struct xring *r;
+    long ret;
+    int cpu;
+
+    if (!n || n > XRING_MAX_ENTRIES || !is_power_of_2(n))
+        return -EINVAL;
+    if (!PAGE_ALIGNED(uring))
+        return -EINVAL;
+    if (current->xring)
+        return -EBUSY;
+
+    if (p->flags & XRING_SETUP_CPU) {
+        cpu = p->cpu;
+        if (cpu < 0 || cpu >= nr_cpu_ids || !cpu_online(cpu))
+            return -EINVAL;
+        // a busy-polling worker on a CPU the caller may not run on is a
+        // scheduling decision on someone else's CPU
+        if (!cpumask_test_cpu(cpu, current->cpus_ptr) && !capable(CAP_SYS_NICE))
+            return -EPERM;
+    } else {
+        cpu = raw_smp_processor_id();
+    }
+
+    r = kzalloc(sizeof(*r), GFP_KERNEL);
+    if (!r)
+        return -ENOMEM;
+    r->nr_pages = PAGE_ALIGN(XRING_SIZE(n)) >> PAGE_SHIFT;
+    r->pages = kvmalloc_array(r->nr_pages, sizeof(struct page *), GFP_KERNEL);
+    if (!r->pages) {
+        ret = -ENOMEM;
+        goto free_ring;
+    }
+
+    // the worker has no user mm: pin the ring and reach it through a vmap
+    ret = pin_user_pages_fast((unsigned long)uring, r->nr_pages,
+                              FOLL_WRITE | FOLL_LONGTERM, r->pages);
+    if (ret != r->nr_pages) {
+        if (ret > 0)
+            unpin_user_pages(r->pages, ret);
+        ret = ret < 0 ? ret : -EFAULT;
+        goto free_pages;
+    }
+    r->base = vmap(r->pages, r->nr_pages, VM_MAP, PAGE_KERNEL);
+    if (!r->base) {
+        ret = -ENOMEM;
+        goto unpin;
+    }
+
+    r->hdr = r->base;
+    r->sq = r->base + XRING_SQ_OFF;
+    r->cq = r->base + XRING_CQ_OFF(n);
+    r->mask = n - 1;
+    memset(r->hdr, 0, sizeof(*r->hdr));
+    r->hdr->entries = n;
+    init_waitqueue_head(&r->cq_wait);
+    /*
+     * the ring is released from the owner's own exit, but the worker may
+     * still be in the middle of a pass, and the group's store is freed
+     * independently of this thread: pin both until xring_release()
+     */
+    get_task_struct(current);
+    r->owner = current;
+    if (current->kv) {
+        kv_store_get(current->kv);
+        r->kv = current->kv;
+    }
+
+    w = xring_get_worker(cpu);
+    if (!w) {
+        ret = -ENOMEM;
+        goto unmap;
+    }
+    r->worker = w;
+
+    mutex_lock(&w->lock);
+    list_add_tail(&r->node, &w->rings);
+    mutex_unlock(&w->lock);
+    current->xring = r;
+    xring_wake_worker(w);
+    return 0;
+
+unmap:
+    kv_store_put(r->kv);
+    put_task_struct(r->owner);
+    vunmap(r->base);
+unpin:
+    unpin_user_pages(r->pages, r->nr_pages);
+free_pages:
+    kvfree(r->pages);
+free_ring:
+    kfree(r);
     return ret;
 }
 
 /**
- * release the kv_store when the task is released
+ * drop @tsk's ring; @tsk must be current. Called on thread exit, exec
+ * and XRING_UNREGISTER.
  */
-void cleanup_task_kv_store(struct task_struct *task)
+void xring_release(struct task_struct *tsk)
+{
+    struct xring *r = tsk->xring;
+
+    if (!r)
+        return;
+    tsk->xring = NULL;
+
+    // waits for a pass that may be using the ring right now
+    mutex_lock(&r->worker->lock);
+    list_del(&r->node);
+    mutex_unlock(&r->worker->lock);
+
+    kv_store_put(r->kv);
+    put_task_struct(r->owner);
+    vunmap(r->base);
+    unpin_user_pages_dirty_lock(r->pages, r->nr_pages, true);
+    kvfree(r->pages);
+    kfree(r);
+}
+
+// asmlinkage long sys_xring_setup(void __user *ring, struct xring_params __user *params); 456
+SYSCALL_DEFINE2(xring_setup, void __user *, ring, struct xring_params __user *, uparams)
+{
+    struct xring_params p;
+
+    if (copy_from_user(&p, uparams, sizeof(p)))
+        return -EFAULT;
+    if ((p.flags & ~(XRING_SETUP_CPU | XRING_UNREGISTER)) ||
+        memchr_inv(p.resv, 0, sizeof(p.resv)))
+        return -EINVAL;
+
+    if (p.flags & XRING_UNREGISTER) {
+        if (!current->xring)
+            return -ENOENT;
+        xring_release(current);
+        return 0;
+    }
+    return xring_register(ring, &p);
+}
+
+static u32 xring_cq_ready(struct xring *r)
+{
+    return READ_ONCE(r->cq_tail) - READ_ONCE(r->hdr->cq_head);
+}
+
+// asmlinkage long sys_xring_enter(unsigned int min_complete, unsigned int flags); 457
+SYSCALL_DEFINE2(xring_enter, unsigned int, min_complete, unsigned int, flags)
+{
+    struct xring *r = current->xring;
+
+    if (flags & ~(XRING_ENTER_WAKEUP | XRING_ENTER_GETEVENTS))
+        return -EINVAL;
+    if (!r)
+        return -ENOENT;
+
+    // waiting for completions of requests nobody is serving would hang
+    if (flags & (XRING_ENTER_WAKEUP | XRING_ENTER_GETEVENTS))
+        xring_wake_worker(r->worker);
+
+    if (flags & XRING_ENTER_GETEVENTS) {
+        if (min_complete > r->mask + 1)
+            return -EINVAL;
+        return wait_event_interruptible(r->cq_wait, xring_cq_ready(r) >= min_complete);
+    }
+    return 0;
+}
+
+/*
+ * multicall: run a vector of whitelisted syscalls in one kernel entry
+ *
+ * Entries are dispatched through sys_call_table with a pt_regs built on
+ * the stack, the same way the entry code does it, so every call keeps
+ * its own argument checks and user-pointer handling. Entry/exit and the
+ * speculation mitigations are paid once per vector.
+ *
+ * Inner calls never pass through the syscall entry work, so the parts of
+ * it that act as policy or observability are repeated per entry: the
+ * seccomp filter, the raw_syscalls tracepoints and an audit record.
+ */
+#ifdef CONFIG_X86_64
+static bool multicall_allowed(unsigned int nr)
+{
+    switch (nr) {
+    case __NR_write_kv:
+    case __NR_read_kv:
+    case __NR_write_kv2:
+    case __NR_read_kv2:
+    case __NR_getxattr:
+    case __NR_lgetxattr:
+    case __NR_fgetxattr:
+    case __NR_listxattr:
+    case __NR_flistxattr:
+    case __NR_getsockopt:
+    case __NR_setsockopt:
+#ifdef __NR_configure_socket_fairness
+    case __NR_configure_socket_fairness:
+#endif
+    case __NR_getpid:
+    case __NR_gettid:
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Run the seccomp filter on @e as if it had been issued on its own.
+ * Returns true if the call may run; otherwise *res is what the filter
+ * asked the call to return. Actions that report a value (ERRNO, a
+ * USER_NOTIF response) write it into the multicall's own registers, so it
+ * is read back from there; TRAP rolls them back instead.
+ */
+static bool multicall_seccomp(const struct multicall_entry *e, unsigned int nr, long *res)
+{
+#ifdef CONFIG_HAVE_ARCH_SECCOMP_FILTER
+    struct pt_regs *outer = current_pt_regs();
+    struct seccomp_data sd = {
+        .nr = nr,
+        .arch = syscall_get_arch(current),
+        .instruction_pointer = outer->ip,
+    };
+    int i;
+
+    if (current->seccomp.mode == SECCOMP_MODE_DISABLED)
+        return true;
+
+    for (i = 0; i < 6; i++)
+        sd.args[i] = e->args[i];
+    syscall_set_return_value(current, outer, -EPERM, 0);
+    if (__secure_computing(&sd) == 0)
+        return true;
+
+    *res = syscall_get_return_value(current, outer);
+    if (*res == outer->orig_ax)
+        *res = -ENOSYS;
+    return false;
+#else
+    return true;
+#endif
+}
+
+static long multicall_one(const struct multicall_entry *e)
+{
+    struct pt_regs regs = {};
+    unsigned int nr;
+    long res;
+
+    if (e->flags || e->nr >= NR_syscalls || !multicall_allowed(e->nr))
+        return -EINVAL;
+    nr = array_index_nospec(e->nr, NR_syscalls);
+
+    regs.orig_ax = nr;
+    regs.di = e->args[0];
+    regs.si = e->args[1];
+    regs.dx = e->args[2];
+    regs.r10 = e->args[3];
+    regs.r8 = e->args[4];
+    regs.r9 = e->args[5];
+
+    if (multicall_seccomp(e, nr, &res)) {
+#ifdef CONFIG_HAVE_SYSCALL_TRACEPOINTS
+        trace_sys_enter(&regs, nr);
+#endif
+        res = sys_call_table[nr](&regs);
+
+        // a single entry cannot be restarted on its own
+        if (res == -ERESTARTSYS || res == -ERESTARTNOINTR ||
+            res == -ERESTARTNOHAND || res == -ERESTART_RESTARTBLOCK)
+            res = -EINTR;
+        regs.ax = res;
+#ifdef CONFIG_HAVE_SYSCALL_TRACEPOINTS
+        trace_sys_exit(&regs, res);
+#endif
+    }
+
+    // one record per entry, attached to the multicall event
+    if (!audit_dummy_context())
+        audit_log(audit_context(), GFP_KERNEL, AUDIT_KERNEL_OTHER,
+                  "op=multicall syscall=%u a0=%llx a1=%llx a2=%llx a3=%llx exit=%ld",
+                  nr, e->args[0], e->args[1], e->args[2], e->args[3], res);
+    return res;
+}
+
+// asmlinkage long sys_multicall(struct multicall_entry __user *vec, int n, unsigned int flags); 458
+SYSCALL_DEFINE3(multicall, struct multicall_entry __user *, uvec, int, n, unsigned int, flags)
+{
+    struct multicall_entry *vec;
+    long res, ret;
+    int i;
+
+    if (flags & ~MULTICALL_FLAGS_MASK)
+        return -EINVAL;
+    if (n < 0 || n > MULTICALL_MAX)
+        return -EINVAL;
+    if (n == 0)
+        return 0;
+
+    vec = memdup_user(uvec, n * sizeof(*vec));
+    if (IS_ERR(vec))
+        return PTR_ERR(vec);
+
+    for (i = 0; i < n; ) {
+        res = multicall_one(&vec[i]);
+        if (put_user(res, &uvec[i].result)) {
+            ret = -EFAULT;
+            goto out;
+        }
+        i++;
+
+        if ((flags & MULTICALL_STOP_ON_ERROR) && IS_ERR_VALUE(res))
+            break;
+        // let the caller handle the signal, it sees how far we got
+        if (signal_pending(current))
+            break;
+        cond_resched();
+    }
+    ret = i;
+out:
+    kfree(vec);
+    return ret;
+}
+#else
+SYSCALL_DEFINE3(multicall, struct multicall_entry __user *, uvec, int, n, unsigned int, flags)
+{
+    return -ENOSYS;
+}
+#endif /* CONFIG_X86_64 */
+
+/*
+ * Syscall cost profiler, see include/linux/sysprof.h
+ *
+ * /sys/kernel/debug/sysprof/
+ *   enable        0/1, flips the static key
+ *   sample_every  record one call in N per CPU (0 or 1: every call)
+ *   reset         write anything to clear the histograms
+ *   hist          summed over CPUs, per call and phase: count, mean and
+ *                 p50/p99 upper bounds in cycles, then "bucket:count" for
+ *                 the non-empty log2 buckets
+ *
+ * Histograms are per CPU so sampling never bounces a shared cache line;
+ * a sample is charged to the CPU the call finishes on.
+ */
+DEFINE_STATIC_KEY_FALSE(sysprof_enabled);
+EXPORT_SYMBOL(sysprof_enabled);
+
+struct sysprof_hist {
+    u64 count[SYSPROF_NR_CALLS];
+    u64 sum[SYSPROF_NR_CALLS][SYSPROF_NR_PHASES];
+    u64 buckets[SYSPROF_NR_CALLS][SYSPROF_NR_PHASES][SYSPROF_BUCKETS];
+};
+
+static DEFINE_PER_CPU(struct sysprof_hist, sysprof_hist);
+static DEFINE_PER_CPU(unsigned int, sysprof_tick);
+static u32 sysprof_sample_every = 1;
+
+static const char * const sysprof_call_names[SYSPROF_NR_CALLS] = {
+    [SYSPROF_WRITE_KV]          = "write_kv",
+    [SYSPROF_READ_KV]           = "read_kv",
+    [SYSPROF_SOCKET_FAIRNESS]   = "configure_socket_fairness",
+};
+
+static const char * const sysprof_phase_names[SYSPROF_NR_PHASES] = {
+    [SYSPROF_ENTRY] = "entry",
+    [SYSPROF_LOCK]  = "lock",
+    [SYSPROF_WORK]  = "work",
+    [SYSPROF_EXIT]  = "exit",
+    [SYSPROF_TOTAL] = "total",
+};
+
+bool __sysprof_should_sample(void)
+{
+    u32 every = READ_ONCE(sysprof_sample_every);
+
+    if (every <= 1)
+        return true;
+    return this_cpu_inc_return(sysprof_tick) % every == 0;
+}
+EXPORT_SYMBOL(__sysprof_should_sample);
+
+static unsigned int sysprof_bucket(u64 cycles)
+{
+    return cycles ? min_t(unsigned int, ilog2(cycles), SYSPROF_BUCKETS - 1) : 0;
+}
+
+void __sysprof_record(struct sysprof_sample *ps, enum sysprof_call call)
+{
+    struct sysprof_hist *h;
+    int i;
+
+    // only process context records, disabling preemption is enough
+    h = get_cpu_ptr(&sysprof_hist);
+    h->count[call]++;
+    for (i = 0; i < SYSPROF_NR_PHASES; i++) {
+        h->sum[call][i] += ps->cycles[i];
+        h->buckets[call][i][sysprof_bucket(ps->cycles[i])]++;
+    }
+    put_cpu_ptr(&sysprof_hist);
+}
+EXPORT_SYMBOL(__sysprof_record);
+
+// upper bound of the bucket holding the pct-th percentile
+static u64 sysprof_percentile(const u64 *buckets, u64 count, unsigned int pct)
+{
+    u64 want = div64_u64(count * pct + 99, 100), seen = 0;
+    int i;
+
+    for (i = 0; i < SYSPROF_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= want)
+            return 2ULL << i;
+    }
+    return 2ULL << (SYSPROF_BUCKETS - 1);
+}
+
+static int sysprof_hist_show(struct seq_file *m, void *v)
+{
+    struct sysprof_hist *sum;
+    int cpu, c, p, i;
+
+    sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+    if (!sum)
+        return -ENOMEM;
+
+    // no locking against writers, a sample in flight may be half counted
+    for_each_possible_cpu(cpu) {
+        struct sysprof_hist *h = per_cpu_ptr(&sysprof_hist, cpu);
+
+        for (c = 0; c < SYSPROF_NR_CALLS; c++) {
+            sum->count[c] += READ_ONCE(h->count[c]);
+            for (p = 0; p < SYSPROF_NR_PHASES; p++) {
+                sum->sum[c][p] += READ_ONCE(h->sum[c][p]);
+                for (i = 0; i < SYSPROF_BUCKETS; i++)
+                    sum->buckets[c][p][i] += READ_ONCE(h->buckets[c][p][i]);
+            }
+        }
+    }
+
+    seq_puts(m, "# call phase count mean p50 p99 [bucket:count ...], in cycles\n");
+    for (c = 0; c < SYSPROF_NR_CALLS; c++) {
+        u64 n = sum->count[c];
+
+        if (!n)
+            continue;
+        for (p = 0; p < SYSPROF_NR_PHASES; p++) {
+            const u64 *b = sum->buckets[c][p];
+
+            seq_printf(m, "%s %s %llu %llu %llu %llu", sysprof_call_names[c],
+                       sysprof_phase_names[p], n, div64_u64(sum->sum[c][p], n),
+                       sysprof_percentile(b, n, 50), sysprof_percentile(b, n, 99));
+            for (i = 0; i < SYSPROF_BUCKETS; i++) {
+                if (b[i])
+                    seq_printf(m, " %d:%llu", i, b[i]);
+            }
+            seq_putc(m, '\n');
+        }
+    }
+
+    kfree(sum);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(sysprof_hist);
+
+static ssize_t sysprof_enable_read(struct file *file, char __user *ubuf,
+                                   size_t count, loff_t *ppos)
+{
+    char buf[2] = { static_key_enabled(&sysprof_enabled) ? '1' : '0', '\n' };
+
+    return simple_read_from_buffer(ubuf, count, ppos, buf, sizeof(buf));
+}
+
+static ssize_t sysprof_enable_write(struct file *file, const char __user *ubuf,
+                                    size_t count, loff_t *ppos)
+{
+    bool on;
+    int ret;
+
+    ret = kstrtobool_from_user(ubuf, count, &on);
+    if (ret)
+        return ret;
+    if (on)
+        static_branch_enable(&sysprof_enabled);
+    else
+        static_branch_disable(&sysprof_enabled);
+    return count;
+}
+
+static const struct file_operations sysprof_enable_fops = {
+    .owner  = THIS_MODULE,
+    .read   = sysprof_enable_read,
+    .write  = sysprof_enable_write,
+    .llseek = default_llseek,
+};
+
+static ssize_t sysprof_reset_write(struct file *file, const char __user *ubuf,
+                                   size_t count, loff_t *ppos)
+{
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+        memset(per_cpu_ptr(&sysprof_hist, cpu), 0, sizeof(struct sysprof_hist));
+    return count;
+}
+
+static const struct file_operations sysprof_reset_fops = {
+    .owner  = THIS_MODULE,
+    .write  = sysprof_reset_write,
+    .llseek = noop_llseek,
+};
+
+static int __init sysprof_init(void)
+{
+    struct dentry *dir = debugfs_create_dir("sysprof", NULL);
+
+    debugfs_create_file("enable", 0600, dir, NULL, &sysprof_enable_fops);
+    debugfs_create_u32("sample_every", 0600, dir, &sysprof_sample_every);
+    debugfs_create_file("reset", 0200, dir, NULL, &sysprof_reset_fops);
+    debugfs_create_file("hist", 0400, dir, NULL, &sysprof_hist_fops);
+    return 0;
+}
+late_initcall(sysprof_init);
+
+/**
+ * take a reference on a shared store: every thread of the group holds one,
+ * and so does every xring that runs requests against it
+ */
+void kv_store_get(struct kv_store *kv)
+{
+    refcount_inc(&kv->users);
+}
+
+/**
+ * drop a reference, freeing the store and its entries with the last one
+ */
+void kv_store_put(struct kv_store *kv)
 {
     struct kv_node *entry;
     struct hlist_node *tmp;
     int i;
 
-    // only clean up the kv_store for the main thread
-    if (task->tgid != task->pid)
+    if (!kv || !refcount_dec_and_test(&kv->users))
         return;
 
-    pr_debug("Cleaning up KV store for process %d\n", task->pid);
-
+    pr_debug("Freeing KV store %p\n", kv);
     for (i = 0; i < 1024; i++) {
-        spin_lock(&task->kv->locks[i]);
-        hlist_for_each_entry_safe(entry, tmp, &task->kv->head[i], node) {
+        hlist_for_each_entry_safe(entry, tmp, &kv->head[i], node) {
             hlist_del(&entry->node);
             kfree(entry);
         }
-        spin_unlock(&task->kv->locks[i]);
     }
+    kfree(kv);
+}
+
+/**
+ * release the kv_store when the task is released
+ */
+void cleanup_task_kv_store(struct task_struct *task)
+{
+    struct kv_node *entry;
+    struct hlist_node *tmp;
+    int i;
+
+    // every thread owns its private store
+    if (task->kv_private) {
+        for (i = 0; i < 1024; i++) {
+            hlist_for_each_entry_safe(entry, tmp, &task->kv_private->head[i], node) {
+                hlist_del(&entry->node);
+                kfree(entry);
+            }
+        }
+        kfree(task->kv_private);
+        task->kv_private = NULL;
+    }
+
+    // the shared store goes away with the last thread (or ring) using it
+    kv_store_put(task->kv);
+    task->kv = NULL;
 }
 
 /**
@@ -122,9 +1225,12 @@ int init_task_kv_store(struct task_struct *task)
         spin_lock_init(&task->kv->locks[i]);
         INIT_HLIST_HEAD(&task->kv->head[i]);
     }
+    refcount_set(&task->kv->users, 1);
     return 0;
 }
 
 /* export function */
 EXPORT_SYMBOL(init_task_kv_store);
-EXPORT_SYMBOL(cleanup_task_kv_store);
\ No newline at end of file
+EXPORT_SYMBOL(cleanup_task_kv_store);
+EXPORT_SYMBOL(kv_store_get);
+EXPORT_SYMBOL(kv_store_put);
\ No newline at end of file
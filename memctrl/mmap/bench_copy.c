@@ -0,0 +1,248 @@
+/*
+ * 大文件流式处理基准: read()、copy_file_range 和 mmap_stream 三条路径
+ *
+ * 用法: ./bench_copy [-s size_mb] [-d dir] [-r repeats] > result.json
+ *
+ * op:
+ *   scan       只读一遍算校验和 (read vs mmap)
+ *   copy       原样复制 (read+write vs copy_file_range vs mmap+pwrite)
+ *   transform  逐字节变换后写出 (read+write vs mmap+pwrite)，copy_file_range 做不了
+ *
+ * 每项分别在冷缓存 (先 POSIX_FADV_DONTNEED 丢掉源文件的页缓存) 和热缓存下
+ * 测，取 repeats 次里最好的一次。大致规律: 热缓存的 scan 上 mmap 省掉了一次
+ * 拷贝；copy 上 copy_file_range 不经过用户态，一般最快，同一文件系统上还
+ * 可能直接 reflink；冷缓存时三者都被磁盘限速，差别主要在预读是否跟得上。
+ */
+#include "mmap_stream.h"
+#include <stdint.h>
+#include <sys/utsname.h>
+#include <time.h>
+
+#define BUF_SIZE (1 << 20)
+
+static char src_path[4096], dst_path[4096];
+static size_t file_size;
+static char *buf;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void drop_cache(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+static void warm_cache(const char *path) {
+    int fd = open(path, O_RDONLY);
+    while (fd >= 0 && read(fd, buf, BUF_SIZE) > 0)
+        ;
+    if (fd >= 0)
+        close(fd);
+}
+
+static void xform(const char *in, char *out, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        out[i] = in[i] ^ 0x5A;
+}
+
+static int xform_cb(const char *in, char *out, size_t len, off_t off, void *arg) {
+    (void)off;
+    (void)arg;
+    xform(in, out, len);
+    return 0;
+}
+
+static volatile uint64_t checksum;   // 让编译器保留 scan 的计算
+
+static int scan_cb(const char *data, size_t len, off_t off, void *arg) {
+    (void)off;
+    (void)arg;
+    uint64_t s = 0;
+    for (size_t i = 0; i + 8 <= len; i += 8)
+        s += *(const uint64_t *)(data + i);
+    checksum += s;
+    return 0;
+}
+
+static int write_all(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int run_read(const char *op) {
+    int in = open(src_path, O_RDONLY), out = -1;
+    ssize_t n;
+
+    if (in < 0)
+        return -1;
+    if (strcmp(op, "scan") != 0 &&
+        (out = open(dst_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        close(in);
+        return -1;
+    }
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+    while ((n = read(in, buf, BUF_SIZE)) > 0) {
+        if (out < 0) {
+            scan_cb(buf, n, 0, NULL);
+            continue;
+        }
+        if (strcmp(op, "transform") == 0)
+            xform(buf, buf, n);
+        if (write_all(out, buf, n) == -1)
+            break;
+    }
+    close(in);
+    if (out >= 0)
+        close(out);
+    return n == 0 ? 0 : -1;
+}
+
+static int run_copy_file_range(const char *op) {
+    if (strcmp(op, "copy") != 0)
+        return 1;   // 不支持
+    int in = open(src_path, O_RDONLY);
+    int out = open(dst_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ssize_t n = 0;
+    size_t left = file_size;
+
+    while (in >= 0 && out >= 0 && left > 0) {
+        n = copy_file_range(in, NULL, out, NULL, left, 0);
+        if (n <= 0)
+            break;
+        left -= n;
+    }
+    if (in >= 0)
+        close(in);
+    if (out >= 0)
+        close(out);
+    return left == 0 ? 0 : -1;
+}
+
+static int run_mmap(const char *op) {
+    struct mmap_stream_opts o = { .chunk = BUF_SIZE };
+
+    if (strcmp(op, "scan") == 0) {
+        int fd = open(src_path, O_RDONLY);
+        if (fd < 0)
+            return -1;
+        int ret = mmap_stream_fd(fd, 0, file_size, &o, scan_cb, NULL);
+        close(fd);
+        return ret;
+    }
+    return mmap_copy_file(src_path, dst_path, &o,
+                          strcmp(op, "transform") == 0 ? xform_cb : NULL, NULL);
+}
+
+static const struct {
+    const char *name;
+    int (*fn)(const char *op);
+} methods[] = {
+    { "read",            run_read },
+    { "copy_file_range", run_copy_file_range },
+    { "mmap",            run_mmap },
+};
+
+static int first_result = 1;
+
+int main(int argc, char **argv) {
+    const char *dir = ".";
+    size_t size_mb = 512;
+    int repeats = 3, opt;
+
+    while ((opt = getopt(argc, argv, "s:d:r:")) != -1) {
+        switch (opt) {
+        case 's': size_mb = strtoul(optarg, NULL, 0); break;
+        case 'd': dir = optarg; break;
+        case 'r': repeats = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-s size_mb] [-d dir] [-r repeats]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (size_mb == 0 || repeats < 1)
+        return 1;
+    file_size = size_mb << 20;
+    snprintf(src_path, sizeof(src_path), "%s/bench_copy.src", dir);
+    snprintf(dst_path, sizeof(dst_path), "%s/bench_copy.dst", dir);
+    buf = malloc(BUF_SIZE);
+
+    // 源文件: 伪随机内容，避免被压缩或去重的文件系统占便宜
+    int fd = open(src_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || !buf) {
+        perror(src_path);
+        return 1;
+    }
+    uint64_t x = 88172645463325252ULL;
+    for (size_t done = 0; done < file_size; done += BUF_SIZE) {
+        for (size_t i = 0; i < BUF_SIZE; i += 8) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            memcpy(buf + i, &x, 8);
+        }
+        if (write_all(fd, buf, BUF_SIZE) == -1) {
+            perror("write");
+            return 1;
+        }
+    }
+    fsync(fd);
+    close(fd);
+
+    struct utsname uts;
+    uname(&uts);
+    printf("{\n");
+    printf("  \"kernel\": \"%s\",\n", uts.release);
+    printf("  \"size_mb\": %zu,\n", size_mb);
+    printf("  \"results\": [\n");
+
+    const char *ops[] = { "scan", "copy", "transform" };
+    for (int cold = 1; cold >= 0; cold--) {
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+            for (size_t m = 0; m < sizeof(methods) / sizeof(methods[0]); m++) {
+                uint64_t best = UINT64_MAX;
+                int ret = 0;
+                for (int r = 0; r < repeats && ret == 0; r++) {
+                    unlink(dst_path);
+                    if (cold)
+                        drop_cache(src_path);
+                    else
+                        warm_cache(src_path);
+                    uint64_t t0 = now_ns();
+                    ret = methods[m].fn(ops[i]);
+                    uint64_t ns = now_ns() - t0;
+                    if (ret == 0 && ns < best)
+                        best = ns;
+                }
+                if (ret > 0)
+                    continue;
+                printf("%s    {\"op\": \"%s\", \"method\": \"%s\", \"cache\": \"%s\", ",
+                       first_result ? "" : ",\n", ops[i], methods[m].name,
+                       cold ? "cold" : "warm");
+                if (ret < 0)
+                    printf("\"error\": \"%s\"}", strerror(errno));
+                else
+                    printf("\"mb_per_sec\": %.1f}", size_mb * 1e9 / best);
+                first_result = 0;
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    unlink(src_path);
+    unlink(dst_path);
+    free(buf);
+    return 0;
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
@@ -5,24 +6,545 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdint.h>
 #include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+
+#ifndef MREMAP_DONTUNMAP
+#define MREMAP_DONTUNMAP 4
+#endif
+#ifndef USERFAULTFD_IOC_NEW
+#define USERFAULTFD_IOC_NEW _IO(0xAA, 0x00) /* /dev/userfaultfd，6.1 */
+#endif
+
+/* mmap_remap_ex 的 flags */
+#define MMAP_REMAP_COPY    0x0 /* 新的物理页 + memcpy，mmap_remap 的默认语义 */
+#define MMAP_REMAP_MOVE    0x1 /* 只移动页表，物理页不变，不复制数据 */
+#define MMAP_REMAP_THP     0x2 /* 按大页对齐放置并 madvise(MADV_HUGEPAGE) */
+#define MMAP_REMAP_HUGETLB 0x4 /* MAP_HUGETLB 显式大页，只能和 COPY 一起用 */
+#define MMAP_REMAP_LAZY    0x8 /* 立即返回，首次访问或后台预取时才复制 (userfaultfd) */
+
+/* file_mmap_write_ex 的 flags */
+#define FILE_MMAP_THP     0x1 /* 对齐映射并 madvise(MADV_HUGEPAGE)，tmpfs huge=advise 等生效 */
+#define FILE_MMAP_HUGETLB 0x2 /* 文件在 hugetlbfs 上：文件和映射长度按大页取整 */
+
+/* mempolicy，不依赖 libnuma 的 numaif.h */
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+#define NODE_BATCH 1024 /* 每次 move_pages 的页数 */
+
+#define ALIGN_UP(x, a) (((x) + (a) - 1) & ~((size_t)(a) - 1))
 
 /**
- * @brief 重新映射一块虚拟内存区域
- * @param addr 原始映射的内存地址，如果为 NULL 则由系统自动选择一个合适的地址
- * @param size 需要映射的大小（单位：字节）
- * @return 成功返回映射的地址，失败返回 NULL
- * @details 该函数用于重新映射一个新的虚拟内存区域。如果 addr 参数为 NULL，
- *          系统会自动选择一个合适的地址进行映射。映射的内存区域大小为 size 字节。
- *          映射失败时返回 NULL。
+ * @brief 默认大页大小
+ * @return /proc/meminfo 中的 Hugepagesize，读不到时返回 2 MiB
  */
-void* mmap_remap(void *addr, size_t size) {
-    void *new_addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
-        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+size_t huge_page_size(void) {
+    static size_t cached;
+    if (cached)
+        return cached;
+
+    size_t kb = 2048;
+    char line[128];
+    FILE *fp = fopen("/proc/meminfo", "r");
+    if (fp) {
+        while (fgets(line, sizeof(line), fp))
+            if (sscanf(line, "Hugepagesize: %zu kB", &kb) == 1)
+                break;
+        fclose(fp);
+    }
+    cached = kb * 1024;
+    return cached;
+}
+
+/*
+ * 预留一段按 align 对齐的 PROT_NONE 地址空间，调用者再用 MAP_FIXED /
+ * MREMAP_FIXED 覆盖上去。多申请 align 字节，然后裁掉头尾。
+ * THP 只能用在 2 MiB 对齐的整块上，地址不对齐时头尾都会退回 4 KiB 页。
+ */
+static void* reserve_aligned(size_t size, size_t align) {
+    size = ALIGN_UP(size, sysconf(_SC_PAGESIZE));
+    size_t len = size + align;
+    char *p = mmap(NULL, len, PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap failed");
+        return NULL;
+    }
+    char *start = (char *)ALIGN_UP((uintptr_t)p, align);
+    if (start > p)
+        munmap(p, start - p);
+    munmap(start + size, p + len - (start + size));
+    return start;
+}
+
+/* 按 flags 分配复制模式的目标区域 */
+static void* mmap_remap_alloc(size_t size, unsigned flags) {
+    void *new_addr;
+
+    if (flags & MMAP_REMAP_HUGETLB) {
+        new_addr = mmap(NULL, ALIGN_UP(size, huge_page_size()), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    } else if (flags & MMAP_REMAP_THP) {
+        new_addr = reserve_aligned(size, huge_page_size());
+        if (new_addr == NULL)
+            return NULL;
+        new_addr = mmap(new_addr, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    } else {
+        new_addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
     if (new_addr == MAP_FAILED) {
         perror("mmap failed");
         return NULL;
     }
+    // 只是提示，THP 被关掉 (never) 时失败也不影响正确性
+    if (flags & MMAP_REMAP_THP)
+        madvise(new_addr, size, MADV_HUGEPAGE);
+    return new_addr;
+}
+
+/*
+ * 零拷贝搬迁：mremap 把页表项整体挂到新地址，开销只和已映射的页数有关。
+ * 同长度的 MREMAP_MAYMOVE 会原地返回，所以要加 DONTUNMAP 强制换地址；
+ * 之后旧区域变成空映射，munmap 掉，和复制模式一样旧地址不再可用。
+ * DONTUNMAP 需要 5.7 (5.13 之前只支持私有匿名映射)，不支持时先预留
+ * 一段新地址再 MREMAP_FIXED 过去，同样不复制。
+ * 要 THP 时目标地址必须大页对齐，直接走预留 + FIXED；源区域已有的大页
+ * 在 addr 本身对齐时原样保留，其余的交给 khugepaged 合并。
+ */
+static void* mmap_remap_move(void *addr, size_t size, unsigned flags) {
+    void *new_addr;
+
+    if (!(flags & MMAP_REMAP_THP)) {
+        new_addr = mremap(addr, size, size, MREMAP_MAYMOVE | MREMAP_DONTUNMAP);
+        if (new_addr != MAP_FAILED) {
+            munmap(addr, size);
+            return new_addr;
+        }
+        if (errno != EINVAL) {
+            perror("mremap failed");
+            return NULL;
+        }
+    }
+
+    void *target = reserve_aligned(size, (flags & MMAP_REMAP_THP) ?
+        huge_page_size() : (size_t)sysconf(_SC_PAGESIZE));
+    if (target == NULL)
+        return NULL;
+    new_addr = mremap(addr, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, target);
+    if (new_addr == MAP_FAILED) {
+        perror("mremap failed");
+        munmap(target, size);
+        return NULL;
+    }
+    if (flags & MMAP_REMAP_THP)
+        madvise(new_addr, size, MADV_HUGEPAGE);
+    return new_addr;
+}
+
+/*
+ * 懒复制：新区域注册到 userfaultfd (MISSING 模式) 后立即返回，旧区域先
+ * 留着。后台线程一边处理缺页，一边从头往后预取:
+ *   - 缺页时把所在的 LAZY_FAULT_PAGES 页一簇用 UFFDIO_COPY 复制过来；
+ *   - 空闲时每轮预取 LAZY_PREFETCH_PAGES 页，缺页总是优先；
+ *   - 旧区域是私有匿名映射时先查 pagemap，既不在内存也不在交换区的页
+ *     内容是 0，不复制也不分配，稀疏区域的开销只和有数据的页数有关。
+ * 全部预取完后解除注册、释放旧区域，线程退出，之后新区域就是普通映射，
+ * 剩下没填的页第一次访问时照常得到 0 页。中途出错 (新区域还在) 时同样
+ * 先解除注册，再把还没填的页直接 memcpy 过去；只有新区域已经被释放时
+ * 才放弃复制 (stats.aborted)。
+ * 线程只在后台运行，调用者不用等它；要确定复制已经结束 (比如计时、
+ * 或者要 mremap 新区域) 时调用 mmap_remap_wait。
+ */
+#define LAZY_FAULT_PAGES    16
+#define LAZY_PREFETCH_PAGES 512
+#define LAZY_PM_DATA        ((1ULL << 63) | (1ULL << 62)) /* pagemap: present | swap */
+
+struct mmap_remap_stats {
+    unsigned long faults;           /* 处理的缺页次数 */
+    unsigned long fault_pages;      /* 缺页时复制的页数 */
+    unsigned long prefetch_pages;   /* 后台预取复制的页数 */
+    unsigned long zero_pages;       /* 缺页时直接映射 0 页的页数 */
+    unsigned long fallback_pages;   /* 出错后解除注册、直接 memcpy 的页数 */
+    int aborted;                    /* 新区域在复制完成前被释放了 */
+};
+
+struct lazy_remap {
+    char *old_addr, *new_addr;
+    size_t npages, page_size;
+    int uffd;
+    int pagemap_fd;                 /* -1: 不知道哪些页为空，全部复制 */
+    uint64_t ent[LAZY_PREFETCH_PAGES];
+    uint8_t *done;                  /* 每页一位，新区域里已经填好 */
+    size_t cursor;                  /* 预取进度 */
+    int finished;
+    struct mmap_remap_stats stats;
+    struct lazy_remap *next;
+};
+
+static pthread_mutex_t lazy_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t lazy_cond = PTHREAD_COND_INITIALIZER;
+static struct lazy_remap *lazy_list;
+
+/*
+ * 不带 UFFD_USER_MODE_ONLY：那样内核态的访问 (比如 read() 读进新区域)
+ * 会直接 EFAULT。需要 CAP_SYS_PTRACE、vm.unprivileged_userfaultfd=1
+ * 或者 /dev/userfaultfd 的访问权限。
+ */
+static int lazy_uffd_open(void) {
+    int uffd = syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+    if (uffd == -1) {
+        int dev = open("/dev/userfaultfd", O_RDWR | O_CLOEXEC);
+        if (dev == -1)
+            return -1;
+        uffd = ioctl(dev, USERFAULTFD_IOC_NEW, O_CLOEXEC | O_NONBLOCK);
+        close(dev);
+        if (uffd == -1)
+            return -1;
+    }
+    struct uffdio_api api = { .api = UFFD_API };
+    if (ioctl(uffd, UFFDIO_API, &api) == -1) {
+        close(uffd);
+        return -1;
+    }
+    return uffd;
+}
+
+/* [addr, addr + size) 是否全部是私有匿名映射，只有这时 pagemap 里的空页才真的是 0 */
+static int lazy_is_private_anon(void *addr, size_t size) {
+    uintptr_t lo = (uintptr_t)addr, hi = lo + size;
+    char line[512], perms[5];
+    unsigned long long start, end, inode;
+    int ok = 0;
+
+    FILE *fp = fopen("/proc/self/maps", "r");
+    if (!fp)
+        return 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%llx-%llx %4s %*s %*s %llu", &start, &end, perms, &inode) != 4)
+            continue;
+        if (end <= lo || start >= hi)
+            continue;
+        if (perms[3] != 'p' || inode != 0) {
+            ok = 0;
+            break;
+        }
+        ok = 1;
+    }
+    fclose(fp);
+    return ok;
+}
+
+static inline int lazy_test(struct lazy_remap *lr, size_t i) {
+    return lr->done[i / 8] & (1 << (i % 8));
+}
+
+static void lazy_set(struct lazy_remap *lr, size_t lo, size_t hi) {
+    for (size_t i = lo; i < hi; i++)
+        lr->done[i / 8] |= 1 << (i % 8);
+}
+
+/* 把旧区域 [lo, hi) 的 pagemap 读进 lr->ent；返回 0 表示不知道哪些页为空 */
+static int lazy_read_pagemap(struct lazy_remap *lr, size_t lo, size_t hi) {
+    ssize_t want = (hi - lo) * sizeof(uint64_t);
+    return lr->pagemap_fd >= 0 &&
+        pread(lr->pagemap_fd, lr->ent, want,
+              ((uintptr_t)lr->old_addr / lr->page_size + lo) * sizeof(uint64_t)) == want;
+}
+
+/*
+ * 填 [lo, hi) 里还没填的页 (hi - lo <= LAZY_PREFETCH_PAGES)。有数据的页按
+ * 连续段 UFFDIO_COPY；没数据的页不动，除非它就是缺页的那一页 fault。
+ * 返回复制的页数，出错返回 -1 并保留 errno。
+ */
+static long lazy_fill(struct lazy_remap *lr, size_t lo, size_t hi, size_t fault) {
+    size_t ps = lr->page_size;
+    long copied = 0;
+    int sparse = lazy_read_pagemap(lr, lo, hi);
+
+    for (size_t i = lo; i < hi; ) {
+        if (lazy_test(lr, i)) {
+            i++;
+            continue;
+        }
+        int data = !sparse || (lr->ent[i - lo] & LAZY_PM_DATA);
+        size_t j = i + 1;
+        while (j < hi && !lazy_test(lr, j) &&
+               (!sparse || (lr->ent[j - lo] & LAZY_PM_DATA)) == data)
+            j++;
+
+        if (data) {
+            struct uffdio_copy copy = {
+                .dst = (uintptr_t)(lr->new_addr + i * ps),
+                .src = (uintptr_t)(lr->old_addr + i * ps),
+                .len = (j - i) * ps,
+            };
+            if (ioctl(lr->uffd, UFFDIO_COPY, &copy) == -1) {
+                if (errno != EEXIST && errno != EAGAIN)
+                    return -1;
+                // 只完成了一部分；EEXIST 说明那一页已经有了，EAGAIN 下次再试
+                size_t n = copy.copy > 0 ? copy.copy / ps : 0;
+                copied += n;
+                j = i + n + (errno == EEXIST);
+            } else {
+                copied += j - i;
+            }
+            lazy_set(lr, i, j);
+        } else if (fault >= i && fault < j) {
+            struct uffdio_zeropage zero = {
+                .range = { (uintptr_t)(lr->new_addr + fault * ps), ps },
+            };
+            if (ioctl(lr->uffd, UFFDIO_ZEROPAGE, &zero) == -1 && errno != EEXIST)
+                return -1;
+            lazy_set(lr, fault, fault + 1);
+            lr->stats.zero_pages++;
+        }
+        i = j;
+    }
+    return copied;
+}
+
+/* 取出所有排队的缺页并处理；返回 -1 表示要放弃 */
+static int lazy_handle_faults(struct lazy_remap *lr) {
+    struct uffd_msg msg;
+    size_t ps = lr->page_size;
+
+    while (read(lr->uffd, &msg, sizeof(msg)) == sizeof(msg)) {
+        if (msg.event != UFFD_EVENT_PAGEFAULT)
+            continue;
+        size_t page = (msg.arg.pagefault.address - (uintptr_t)lr->new_addr) / ps;
+        size_t lo = page / LAZY_FAULT_PAGES * LAZY_FAULT_PAGES;
+        size_t hi = lo + LAZY_FAULT_PAGES < lr->npages ? lo + LAZY_FAULT_PAGES : lr->npages;
+
+        lr->stats.faults++;
+        long n = lazy_fill(lr, lo, hi, page);
+        if (n < 0)
+            return -1;
+        lr->stats.fault_pages += n;
+        // 可能已经被预取填好了，那次 COPY 唤醒不了排在它之后的缺页
+        struct uffdio_range range = { (uintptr_t)lr->new_addr + page * ps, ps };
+        ioctl(lr->uffd, UFFDIO_WAKE, &range);
+    }
+    return errno == EAGAIN ? 0 : -1;
+}
+
+/*
+ * lazy_fill / lazy_handle_faults 失败后，判断是不是新区域已经不在了：
+ * 目标 VMA 没了 (或不再注册) 时 UFFDIO_COPY 返回 ENOENT，mm 没了返回
+ * ESRCH；读缺页消息失败时没有这样的 errno，用 mincore 查整个新区域。
+ */
+static int lazy_dst_gone(struct lazy_remap *lr, int err) {
+    size_t chunk = sizeof(lr->ent);  /* mincore 每页一字节，借 ent 当缓冲 */
+
+    if (err == ENOENT || err == ESRCH)
+        return 1;
+    for (size_t i = 0; i < lr->npages; i += chunk) {
+        size_t n = lr->npages - i < chunk ? lr->npages - i : chunk;
+        if (mincore(lr->new_addr + i * lr->page_size, n * lr->page_size,
+                    (unsigned char *)lr->ent) == -1)
+            return 1;
+    }
+    return 0;
+}
+
+static void* lazy_thread(void *arg) {
+    struct lazy_remap *lr = arg;
+    struct pollfd pfd = { .fd = lr->uffd, .events = POLLIN };
+
+    while (lr->cursor < lr->npages) {
+        if (poll(&pfd, 1, 0) > 0 && lazy_handle_faults(lr) == -1)
+            break;
+        size_t hi = lr->cursor + LAZY_PREFETCH_PAGES;
+        if (hi > lr->npages)
+            hi = lr->npages;
+        long n = lazy_fill(lr, lr->cursor, hi, SIZE_MAX);
+        if (n < 0)
+            break;
+        lr->stats.prefetch_pages += n;
+        lr->cursor = hi;
+    }
+    int gone = lr->cursor < lr->npages && lazy_dst_gone(lr, errno);
+    lr->stats.aborted = gone;
+
+    // 解除注册会唤醒还在等的缺页，它们重新缺页时得到普通的 0 页
+    struct uffdio_range range = { (uintptr_t)lr->new_addr, lr->npages * lr->page_size };
+    ioctl(lr->uffd, UFFDIO_UNREGISTER, &range);
+    /*
+     * 其它错误 (比如 UFFDIO_COPY 的 ENOMEM) 时新区域还在用，剩下的页直接
+     * memcpy 过去再释放旧区域，否则这些页的数据就丢了。解除注册之后、
+     * memcpy 之前别的线程对这些页的写会被覆盖。
+     */
+    for (size_t lo = lr->cursor < lr->npages && !gone ? 0 : lr->npages; lo < lr->npages;
+         lo += LAZY_PREFETCH_PAGES) {
+        size_t hi = lo + LAZY_PREFETCH_PAGES < lr->npages ? lo + LAZY_PREFETCH_PAGES : lr->npages;
+        int sparse = lazy_read_pagemap(lr, lo, hi);
+
+        for (size_t i = lo; i < hi; i++) {
+            if (lazy_test(lr, i) || (sparse && !(lr->ent[i - lo] & LAZY_PM_DATA)))
+                continue;
+            memcpy(lr->new_addr + i * lr->page_size, lr->old_addr + i * lr->page_size,
+                   lr->page_size);
+            lr->stats.fallback_pages++;
+        }
+    }
+    close(lr->uffd);
+    if (lr->pagemap_fd >= 0)
+        close(lr->pagemap_fd);
+    munmap(lr->old_addr, lr->npages * lr->page_size);
+    free(lr->done);
+
+    pthread_mutex_lock(&lazy_lock);
+    lr->finished = 1;
+    pthread_cond_broadcast(&lazy_cond);
+    pthread_mutex_unlock(&lazy_lock);
+    return NULL;
+}
+
+void* mmap_remap_ex(void *addr, size_t size, unsigned flags);
+
+static void* mmap_remap_lazy(void *addr, size_t size, unsigned flags) {
+    size_t ps = (size_t)sysconf(_SC_PAGESIZE);
+    struct lazy_remap *lr = calloc(1, sizeof(*lr));
+    pthread_attr_t attr;
+    pthread_t tid;
+
+    // 用不了 userfaultfd 时退回普通复制，结果一样，只是要等 memcpy
+    int uffd = lr ? lazy_uffd_open() : -1;
+    if (uffd == -1) {
+        free(lr);
+        return mmap_remap_ex(addr, size, flags & ~MMAP_REMAP_LAZY);
+    }
+    lr->uffd = uffd;
+    lr->old_addr = addr;
+    lr->page_size = ps;
+    lr->npages = ALIGN_UP(size, ps) / ps;
+    lr->pagemap_fd = lazy_is_private_anon(addr, size) ?
+        open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC) : -1;
+    lr->done = calloc((lr->npages + 7) / 8, 1);
+    lr->new_addr = lr->done ? mmap_remap_alloc(size, flags) : NULL;
+    if (lr->new_addr == NULL)
+        goto err;
+
+    struct uffdio_register reg = {
+        .range = { (uintptr_t)lr->new_addr, lr->npages * ps },
+        .mode = UFFDIO_REGISTER_MODE_MISSING,
+    };
+    if (ioctl(uffd, UFFDIO_REGISTER, &reg) == -1) {
+        perror("UFFDIO_REGISTER failed");
+        munmap(lr->new_addr, size);
+        goto err;
+    }
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_mutex_lock(&lazy_lock);
+    // 同一地址上已经结束但没人 wait 的旧记录不再有意义
+    for (struct lazy_remap **pp = &lazy_list; *pp; ) {
+        struct lazy_remap *p = *pp;
+        if (p->finished && p->new_addr == lr->new_addr) {
+            *pp = p->next;
+            free(p);
+        } else {
+            pp = &p->next;
+        }
+    }
+    lr->next = lazy_list;
+    lazy_list = lr;
+    int ret = pthread_create(&tid, &attr, lazy_thread, lr);
+    if (ret != 0)
+        lazy_list = lr->next;
+    pthread_mutex_unlock(&lazy_lock);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
+        errno = ret;
+        perror("pthread_create failed");
+        munmap(lr->new_addr, size);
+        goto err;
+    }
+    return lr->new_addr;
+err:
+    close(uffd);
+    if (lr->pagemap_fd >= 0)
+        close(lr->pagemap_fd);
+    free(lr->done);
+    free(lr);
+    return NULL;
+}
+
+/**
+ * @brief 等待 MMAP_REMAP_LAZY 的后台复制结束
+ * @param addr mmap_remap_ex 返回的地址
+ * @param stats 非 NULL 时返回复制统计；addr 不是懒复制得到的时全为 0
+ * @return 总是返回 0
+ * @details 返回后旧区域已经释放，新区域是普通映射，可以 mremap、fork 等。
+ *          复制结束前 fork 的子进程里，还没复制的页会读成 0。
+ */
+int mmap_remap_wait(void *addr, struct mmap_remap_stats *stats) {
+    struct lazy_remap *lr = NULL;
+
+    pthread_mutex_lock(&lazy_lock);
+    for (struct lazy_remap **pp = &lazy_list; *pp; pp = &(*pp)->next) {
+        if ((*pp)->new_addr == addr) {
+            lr = *pp;
+            while (!lr->finished)
+                pthread_cond_wait(&lazy_cond, &lazy_lock);
+            *pp = lr->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lazy_lock);
+
+    if (stats) {
+        if (lr)
+            *stats = lr->stats;
+        else
+            memset(stats, 0, sizeof(*stats));
+    }
+    free(lr);
+    return 0;
+}
+
+/**
+ * @brief 按指定方式重新映射一块虚拟内存区域
+ * @param addr 原始映射的内存地址，如果为 NULL 则只分配新区域
+ * @param size 需要映射的大小（单位：字节）
+ * @param flags MMAP_REMAP_COPY、MMAP_REMAP_MOVE 或 MMAP_REMAP_LAZY，可以
+ *              再或上 MMAP_REMAP_THP；MMAP_REMAP_HUGETLB 只能用于复制
+ * @return 成功返回新的地址，失败返回 NULL（原区域保持不变）
+ * @details 两种方式都会返回与 addr 不同的地址，并释放原区域。
+ *          COPY 得到全新的物理页，数据逐字节复制；MOVE 沿用原来的物理页，
+ *          不产生内存拷贝和缺页，适合大区域。
+ *          LAZY 和 COPY 结果相同，但立即返回，数据在首次访问或后台预取
+ *          时才复制，旧区域在复制完成后释放，见 mmap_remap_wait。
+ *          HUGETLB 需要预留大页 (/proc/sys/vm/nr_hugepages)，否则返回 NULL；
+ *          这样得到的区域 munmap 时长度要按 huge_page_size() 取整。
+ */
+void* mmap_remap_ex(void *addr, size_t size, unsigned flags) {
+    if ((flags & ~(MMAP_REMAP_MOVE | MMAP_REMAP_THP | MMAP_REMAP_HUGETLB | MMAP_REMAP_LAZY)) ||
+        ((flags & MMAP_REMAP_HUGETLB) && (flags & ~MMAP_REMAP_HUGETLB)) ||
+        ((flags & MMAP_REMAP_MOVE) && (flags & MMAP_REMAP_LAZY))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (addr != NULL && (flags & MMAP_REMAP_MOVE))
+        return mmap_remap_move(addr, size, flags);
+    if (addr != NULL && (flags & MMAP_REMAP_LAZY))
+        return mmap_remap_lazy(addr, size, flags);
+    flags &= ~MMAP_REMAP_LAZY;
+
+    void *new_addr = mmap_remap_alloc(size, flags);
+    if (new_addr == NULL)
+        return NULL;
     // copy old data to new area
     if (addr != NULL) {
         memcpy(new_addr, addr, size);
@@ -33,18 +555,214 @@ void* mmap_remap(void *addr, size_t size) {
 }
 
 /**
- * @brief 使用 mmap 进行文件读写
+ * @brief 重新映射一块虚拟内存区域
+ * @param addr 原始映射的内存地址，如果为 NULL 则由系统自动选择一个合适的地址
+ * @param size 需要映射的大小（单位：字节）
+ * @return 成功返回映射的地址，失败返回 NULL
+ * @details 该函数用于重新映射一个新的虚拟内存区域。如果 addr 参数为 NULL，
+ *          系统会自动选择一个合适的地址进行映射。映射的内存区域大小为 size 字节。
+ *          映射失败时返回 NULL。新区域使用新的物理页 (MMAP_REMAP_COPY)。
+ */
+void* mmap_remap(void *addr, size_t size) {
+    return mmap_remap_ex(addr, size, MMAP_REMAP_COPY);
+}
+
+struct mmap_node_stats {
+    unsigned long pages;    /* 完成后区域内驻留的页数 */
+    unsigned long moved;    /* 从别的节点搬到目标节点的页数 (COPY: 复制到目标节点的页数) */
+    unsigned long failed;   /* 驻留但最终不在目标节点上的页数 */
+    uint64_t ns;            /* 搬迁或复制本身花的时间 */
+    double mb_per_sec;      /* moved 页的带宽 */
+    int error;              /* MOVE 时 mbind/move_pages 出错的 errno，0 表示没出错 */
+};
+
+/* 把 [addr, addr + size) 的内存策略设为只在 node 上分配，flags 可以带 MPOL_MF_MOVE */
+static int node_bind(void *addr, size_t size, int node, unsigned flags) {
+    unsigned long mask[node / (8 * sizeof(unsigned long)) + 1];
+
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_mbind, addr, size, MPOL_BIND, mask, node + 2, flags) == -1) {
+        // 没编译 NUMA 的内核只有节点 0，策略无从谈起
+        if (errno == ENOSYS && node == 0)
+            return 0;
+        perror("mbind failed");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * 用 move_pages 逐批处理 [addr, addr + size)：先查每页所在节点，不在 node
+ * 上的驻留页再一次 move_pages 搬过去。target < 0 时只统计不搬。
+ * status 为 -ENOENT 的是没有驻留的页，不计数。
+ */
+static int node_migrate(void *addr, size_t size, int target, int node,
+                        struct mmap_node_stats *st) {
+    size_t ps = (size_t)sysconf(_SC_PAGESIZE);
+    size_t npages = ALIGN_UP(size, ps) / ps;
+    void *pages[NODE_BATCH], *todo[NODE_BATCH];
+    int status[NODE_BATCH], nodes[NODE_BATCH];
+
+    for (size_t i = 0; i < npages; i += NODE_BATCH) {
+        size_t n = npages - i < NODE_BATCH ? npages - i : NODE_BATCH, m = 0;
+        for (size_t k = 0; k < n; k++)
+            pages[k] = (char *)addr + (i + k) * ps;
+        if (syscall(SYS_move_pages, 0, n, pages, NULL, status, 0) == -1) {
+            if (errno == ENOSYS && node == 0) {
+                // 非 NUMA 内核: 驻留的页都算在节点 0 上
+                unsigned char vec[NODE_BATCH];
+                if (mincore(pages[0], n * ps, vec) == 0)
+                    for (size_t k = 0; k < n; k++)
+                        st->pages += vec[k] & 1;
+                continue;
+            }
+            perror("move_pages failed");
+            return -1;
+        }
+        for (size_t k = 0; k < n; k++) {
+            if (status[k] == -ENOENT)
+                continue;
+            st->pages++;
+            if (status[k] == node)
+                continue;
+            if (target < 0) {
+                st->failed++;
+                continue;
+            }
+            todo[m] = pages[k];
+            nodes[m++] = target;
+        }
+        if (m == 0)
+            continue;
+        if (syscall(SYS_move_pages, 0, m, todo, nodes, status, MPOL_MF_MOVE) == -1) {
+            perror("move_pages failed");
+            return -1;
+        }
+        for (size_t k = 0; k < m; k++) {
+            if (status[k] == node)
+                st->moved++;
+            else
+                st->failed++;
+        }
+    }
+    return 0;
+}
+
+/* [addr, addr + size) 中驻留的页数 */
+static unsigned long node_resident(void *addr, size_t size) {
+    size_t ps = (size_t)sysconf(_SC_PAGESIZE);
+    size_t npages = ALIGN_UP(size, ps) / ps;
+    unsigned char vec[NODE_BATCH];
+    unsigned long cnt = 0;
+
+    for (size_t i = 0; i < npages; i += NODE_BATCH) {
+        size_t n = npages - i < NODE_BATCH ? npages - i : NODE_BATCH;
+        if (mincore((char *)addr + i * ps, n * ps, vec) == 0)
+            for (size_t k = 0; k < n; k++)
+                cnt += vec[k] & 1;
+    }
+    return cnt;
+}
+
+static uint64_t node_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief 重新映射一块区域，并把它的物理页放到指定的 NUMA 节点上
+ * @param addr 原始映射的内存地址，如果为 NULL 则只分配新区域
+ * @param size 区域大小（单位：字节）
+ * @param node 目标节点
+ * @param flags MMAP_REMAP_COPY 或 MMAP_REMAP_MOVE，可以再或上 MMAP_REMAP_THP
+ * @param stats 非 NULL 时返回搬迁的页数和带宽
+ * @return 成功返回新的地址，失败返回 NULL（原区域保持不变）
+ * @details 新区域的内存策略是 MPOL_BIND 到 node，之后缺页分配的页也在
+ *          node 上。COPY 先绑定再 memcpy，数据直接写到目标节点；MOVE 用
+ *          mremap 换地址后 move_pages 迁移不在 node 上的页，已经在 node 上
+ *          的页不动，所以已在本地的数据几乎没有开销。节点内存不够时
+ *          move_pages 可能留下一部分页，计入 stats->failed，不算失败；
+ *          MOVE 时 mbind 或 move_pages 本身出错 (EPERM、ENOMEM、节点下线等)
+ *          也返回新地址，errno 记在 stats->error，没搬成的驻留页计入 failed。
+ */
+void* mmap_remap_node(void *addr, size_t size, int node, unsigned flags,
+                      struct mmap_node_stats *stats) {
+    struct mmap_node_stats st = { 0 };
+    char path[64];
+    void *new_addr;
+
+    // 没有 node 目录 (非 NUMA 内核) 时只有节点 0
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", node);
+    int exists = access("/sys/devices/system/node", F_OK) == 0 ?
+        access(path, F_OK) == 0 : node == 0;
+    if ((flags & ~(MMAP_REMAP_MOVE | MMAP_REMAP_THP)) || node < 0 || !exists) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    uint64_t t0 = 0, t1 = 0;
+    if (addr != NULL && (flags & MMAP_REMAP_MOVE)) {
+        new_addr = mmap_remap_move(addr, size, flags);
+        if (new_addr == NULL)
+            return NULL;
+        // 到这里旧区域已经不在了，后面失败也只能返回新地址，在 stats 里报告
+        if (node_bind(new_addr, size, node, 0) == -1)
+            st.error = errno;
+        t0 = node_now_ns();
+        if (node_migrate(new_addr, size, node, node, &st) == -1) {
+            // 出错那一批及之后的页都没处理，驻留的都算没搬成
+            st.error = errno;
+            st.pages = node_resident(new_addr, size);
+            st.failed = st.pages - st.moved;
+        }
+        t1 = node_now_ns();
+    } else {
+        new_addr = mmap_remap_alloc(size, flags);
+        if (new_addr == NULL)
+            return NULL;
+        if (node_bind(new_addr, size, node, 0) == -1) {
+            munmap(new_addr, size);
+            return NULL;
+        }
+        if (addr != NULL) {
+            t0 = node_now_ns();
+            memcpy(new_addr, addr, size);
+            t1 = node_now_ns();
+            munmap(addr, size);
+        }
+        // 复制出来的页都算搬迁，按实际所在节点核对
+        node_migrate(new_addr, size, -1, node, &st);
+        st.moved = st.pages - st.failed;
+    }
+    if (t0) {
+        st.ns = t1 - t0;
+        if (st.ns)
+            st.mb_per_sec = (double)st.moved * sysconf(_SC_PAGESIZE) / (1 << 20) * 1e9 / st.ns;
+    }
+    if (stats)
+        *stats = st;
+    return new_addr;
+}
+
+/**
+ * @brief 使用 mmap 进行文件读写，可选大页
  * @param filename 待操作的文件路径
  * @param offset 写入文件的偏移量（单位：字节）
  * @param content 要写入文件的内容
+ * @param flags 0、FILE_MMAP_THP 或 FILE_MMAP_HUGETLB
  * @return 成功返回 0，失败返回 -1
- * @details 该函数使用内存映射（mmap）的方式进行文件写入操作。
- *          通过 filename 指定要写入的文件，
- *          offset 指定写入的起始位置，
- *          content 指定要写入的内容。
- *          写入成功返回 0，失败返回 -1。
+ * @details 普通文件系统的页缓存一般不用大页，FILE_MMAP_THP 主要对
+ *          tmpfs (huge=advise) 有效。FILE_MMAP_HUGETLB 要求文件位于
+ *          hugetlbfs，文件大小会被取整到大页。
  */
-int file_mmap_write(const char* filename, size_t offset, char* content) {
+int file_mmap_write_ex(const char* filename, size_t offset, char* content, unsigned flags) {
+    if (flags & ~(FILE_MMAP_THP | FILE_MMAP_HUGETLB)) {
+        errno = EINVAL;
+        return -1;
+    }
+
     // R/W mode 打开文件，创建文件描述符 若无文件则创建
     int fd = open(filename, O_RDWR | O_CREAT, 0644);
     if (fd == -1) {
@@ -54,6 +772,9 @@ int file_mmap_write(const char* filename, size_t offset, char* content) {
     
     size_t content_len = strlen(content);
     off_t total_len = offset + content_len;
+    // hugetlbfs 的文件大小和映射长度都必须是大页的整数倍
+    if (flags & FILE_MMAP_HUGETLB)
+        total_len = ALIGN_UP((size_t)total_len, huge_page_size());
     
     // 获取文件大小
     struct stat st;
@@ -72,18 +793,34 @@ int file_mmap_write(const char* filename, size_t offset, char* content) {
         }
     }
 
-    void *map = mmap(NULL, total_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    void *hint = NULL;
+    int map_flags = MAP_SHARED;
+    if (flags & FILE_MMAP_THP) {
+        hint = reserve_aligned(total_len, huge_page_size());
+        if (hint == NULL) {
+            close(fd);
+            return -1;
+        }
+        map_flags |= MAP_FIXED;
+    }
+
+    void *map = mmap(hint, total_len, PROT_READ | PROT_WRITE, map_flags, fd, 0);
     if (map == MAP_FAILED) {
         perror("mmap failed");
+        if (hint)
+            munmap(hint, total_len);
         close(fd);
         return -1;
     }
+    if (flags & FILE_MMAP_THP)
+        madvise(map, total_len, MADV_HUGEPAGE);
     
     memcpy(map + offset, content, content_len);
     
     if (msync(map, total_len, MS_SYNC) == -1) {
         perror("msync failed");
         munmap(map, total_len);
+        close(fd);
         return -1;
     }
     
@@ -91,3 +828,19 @@ int file_mmap_write(const char* filename, size_t offset, char* content) {
     close(fd);
     return 0;
 }
+
+/**
+ * @brief 使用 mmap 进行文件读写
+ * @param filename 待操作的文件路径
+ * @param offset 写入文件的偏移量（单位：字节）
+ * @param content 要写入文件的内容
+ * @return 成功返回 0，失败返回 -1
+ * @details 该函数使用内存映射（mmap）的方式进行文件写入操作。
+ *          通过 filename 指定要写入的文件，
+ *          offset 指定写入的起始位置，
+ *          content 指定要写入的内容。
+ *          写入成功返回 0，失败返回 -1。
+ */
+int file_mmap_write(const char* filename, size_t offset, char* content) {
+    return file_mmap_write_ex(filename, offset, content, 0);
+}
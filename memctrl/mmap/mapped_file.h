@@ -0,0 +1,264 @@
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+/*
+ * 常驻映射的文件写入句柄
+ *
+ * file_mmap_write 每次都要 open/fstat/ftruncate/mmap/msync/munmap。这里把
+ * fd 和映射留在句柄里，写入只是一次 memcpy 加一次脏区间登记:
+ *
+ *     struct mapped_file *mf = mapped_file_open("data.bin", O_CREAT);
+ *     mapped_file_write(mf, off, buf, len);      // 不进内核 (缺页除外)
+ *     mapped_file_commit(mf);                    // 只刷脏区间
+ *     mapped_file_close(mf);
+ *
+ * 文件按 2 倍增长 (ftruncate 到容量，是稀疏的)，映射用 mremap 跟着扩大。
+ * 逻辑大小是写到过的最远位置，close 时把文件截回逻辑大小。两次 commit
+ * 之间崩溃的话，磁盘上的文件可能带着一段到容量为止的全 0 尾巴。
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* mremap, sync_file_range */
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAPPED_FILE_MIN_CAP (1UL << 20) /* 初始容量 1 MiB */
+
+/* 页对齐的脏区间 [lo, hi) */
+struct mapped_file_range {
+    size_t lo, hi;
+};
+
+struct mapped_file {
+    int fd;
+    char *map;          /* 文件偏移 0 处 */
+    size_t cap;         /* 映射长度 = 文件当前长度，页对齐 */
+    size_t size;        /* 逻辑大小 */
+    struct mapped_file_range *dirty;    /* 按 lo 排序且互不相邻 */
+    size_t nr_dirty, dirty_cap;
+    /* 统计 */
+    unsigned long writes, commits, grows;
+};
+
+static inline size_t mapped_file_page_align(size_t x) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (x + page - 1) & ~(page - 1);
+}
+
+/*
+ * 把容量扩到至少 need：先 ftruncate 再 mremap，顺序反过来的话新映射的
+ * 尾部会短暂越过 EOF。映射可能搬到新地址，句柄外不要缓存 map 指针。
+ */
+static int mapped_file_grow(struct mapped_file *mf, size_t need) {
+    size_t cap = mf->cap;
+    while (cap < need)
+        cap *= 2;
+    cap = mapped_file_page_align(cap);
+
+    if (ftruncate(mf->fd, cap) == -1) {
+        perror("ftruncate failed");
+        return -1;
+    }
+    void *map = mremap(mf->map, mf->cap, cap, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) {
+        perror("mremap failed");
+        return -1;
+    }
+    mf->map = map;
+    mf->cap = cap;
+    mf->grows++;
+    return 0;
+}
+
+/* 登记 [lo, hi)，和已有区间合并；顺序写只会碰到最后一个区间 */
+static int mapped_file_mark_dirty(struct mapped_file *mf, size_t lo, size_t hi) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    struct mapped_file_range *r = mf->dirty;
+    size_t n = mf->nr_dirty, i, j;
+
+    lo &= ~(page - 1);
+    hi = mapped_file_page_align(hi);
+
+    if (n && r[n - 1].hi >= lo && r[n - 1].lo <= hi) {
+        if (lo >= r[n - 1].lo) {
+            if (hi > r[n - 1].hi)
+                r[n - 1].hi = hi;
+            return 0;
+        }
+    } else if (!n || r[n - 1].hi < lo) {
+        i = j = n;
+        goto insert;
+    }
+
+    for (i = 0; i < n && r[i].hi < lo; i++)
+        ;
+    for (j = i; j < n && r[j].lo <= hi; j++) {
+        if (r[j].lo < lo)
+            lo = r[j].lo;
+        if (r[j].hi > hi)
+            hi = r[j].hi;
+    }
+insert:
+    // r[i..j) 被合并成一个区间
+    if (i == j) {
+        if (n == mf->dirty_cap) {
+            size_t cap = mf->dirty_cap ? mf->dirty_cap * 2 : 16;
+            r = realloc(r, cap * sizeof(*r));
+            if (!r)
+                return -1;
+            mf->dirty = r;
+            mf->dirty_cap = cap;
+        }
+        memmove(&r[i + 1], &r[i], (n - i) * sizeof(*r));
+        mf->nr_dirty++;
+    } else if (j - i > 1) {
+        memmove(&r[i + 1], &r[j], (n - j) * sizeof(*r));
+        mf->nr_dirty -= j - i - 1;
+    }
+    r[i].lo = lo;
+    r[i].hi = hi;
+    return 0;
+}
+
+/**
+ * @brief 打开 (或创建) 文件并建立常驻映射
+ * @param filename 文件路径
+ * @param oflags 额外的 open 标志，如 O_CREAT、O_TRUNC；总是以 O_RDWR 打开
+ * @return 成功返回句柄，失败返回 NULL
+ */
+static inline struct mapped_file *mapped_file_open(const char *filename, int oflags) {
+    struct mapped_file *mf = calloc(1, sizeof(*mf));
+    struct stat st;
+
+    if (!mf)
+        return NULL;
+    mf->fd = open(filename, O_RDWR | oflags, 0644);
+    if (mf->fd == -1) {
+        perror("open failed");
+        free(mf);
+        return NULL;
+    }
+    if (fstat(mf->fd, &st) == -1) {
+        perror("fstat failed");
+        goto err;
+    }
+    mf->size = st.st_size;
+    mf->cap = mapped_file_page_align(st.st_size > (off_t)MAPPED_FILE_MIN_CAP ?
+                                     (size_t)st.st_size : MAPPED_FILE_MIN_CAP);
+    if ((size_t)st.st_size < mf->cap && ftruncate(mf->fd, mf->cap) == -1) {
+        perror("ftruncate failed");
+        goto err;
+    }
+    mf->map = mmap(NULL, mf->cap, PROT_READ | PROT_WRITE, MAP_SHARED, mf->fd, 0);
+    if (mf->map == MAP_FAILED) {
+        perror("mmap failed");
+        if ((size_t)st.st_size < mf->cap)
+            ftruncate(mf->fd, st.st_size);
+        goto err;
+    }
+    return mf;
+err:
+    close(mf->fd);
+    free(mf);
+    return NULL;
+}
+
+/**
+ * @brief 把 buf 写到文件的 offset 处，必要时扩大文件
+ * @return 成功返回 0，失败返回 -1
+ * @note 只写到页缓存，持久化要调用 mapped_file_commit
+ */
+static inline int mapped_file_write(struct mapped_file *mf, size_t offset,
+                                    const void *buf, size_t len) {
+    size_t end = offset + len;
+
+    if (end < offset) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    if (len == 0)
+        return 0;
+    if (end > mf->cap && mapped_file_grow(mf, end) == -1)
+        return -1;
+    if (mapped_file_mark_dirty(mf, offset, end) == -1)
+        return -1;
+
+    memcpy(mf->map + offset, buf, len);
+    if (end > mf->size)
+        mf->size = end;
+    mf->writes++;
+    return 0;
+}
+
+/**
+ * @brief 在文件末尾追加
+ * @return 成功返回写入位置，失败返回 -1
+ */
+static inline off_t mapped_file_append(struct mapped_file *mf, const void *buf, size_t len) {
+    size_t offset = mf->size;
+    return mapped_file_write(mf, offset, buf, len) == 0 ? (off_t)offset : -1;
+}
+
+/*
+ * 每个区间先 sync_file_range 发起回写，最后一次 fdatasync 等待完成并带上
+ * 文件长度，比对每个区间 msync(MS_SYNC) 少了多次日志提交。只用 fd，
+ * 不碰映射，可以在别的线程扩容时调用。
+ */
+static inline int mapped_file_sync_ranges(int fd, const struct mapped_file_range *r, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        sync_file_range(fd, r[i].lo, r[i].hi - r[i].lo, SYNC_FILE_RANGE_WRITE);
+    if (fdatasync(fd) == -1) {
+        perror("fdatasync failed");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 持久化自上次 commit 以来写过的区间
+ * @return 成功返回 0，失败返回 -1 (脏区间保留，可以重试)
+ */
+static inline int mapped_file_commit(struct mapped_file *mf) {
+    if (mf->nr_dirty == 0)
+        return 0;
+    if (mapped_file_sync_ranges(mf->fd, mf->dirty, mf->nr_dirty) == -1)
+        return -1;
+    mf->nr_dirty = 0;
+    mf->commits++;
+    return 0;
+}
+
+/**
+ * @brief 解除映射，把文件截回逻辑大小并关闭
+ * @return 成功返回 0，失败返回 -1 (句柄总会被释放)
+ * @note 不会替调用者 commit；只在截断了预分配的尾巴时 fdatasync 一次，
+ *       保证磁盘上的长度和已提交的数据一致
+ */
+static inline int mapped_file_close(struct mapped_file *mf) {
+    int ret = 0;
+
+    munmap(mf->map, mf->cap);
+    if (mf->cap > mf->size) {
+        if (ftruncate(mf->fd, mf->size) == -1) {
+            perror("ftruncate failed");
+            ret = -1;
+        } else if (mf->commits && fdatasync(mf->fd) == -1) {
+            perror("fdatasync failed");
+            ret = -1;
+        }
+    }
+    if (close(mf->fd) == -1)
+        ret = -1;
+    free(mf->dirty);
+    free(mf);
+    return ret;
+}
+
+#endif // _MAPPED_FILE_H
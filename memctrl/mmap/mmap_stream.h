@@ -0,0 +1,239 @@
+#ifndef _MMAP_STREAM_H
+#define _MMAP_STREAM_H
+
+/*
+ * 用滑动窗口 mmap 流式处理比内存还大的文件
+ *
+ * 一次只映射 window 字节，按 chunk 把数据交给回调。游标前方用
+ * MADV_WILLNEED / POSIX_FADV_WILLNEED 预读 readahead 字节，处理过的部分
+ * 用 MADV_DONTNEED 解除映射，进程的 RSS 和页表都不会随文件增长；需要的
+ * 话 (MMAP_STREAM_DROP_CACHE) 再用 POSIX_FADV_DONTNEED 把页缓存也还回去。
+ *
+ *     static int sum(const char *data, size_t len, off_t off, void *arg) {...}
+ *     mmap_stream_fd(fd, 0, size, NULL, sum, &total);
+ *
+ * mmap_copy_file 在此之上实现复制，可以带一个逐块变换的回调。
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* sync_file_range */
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef MADV_POPULATE_READ
+#define MADV_POPULATE_READ 22   /* 5.14 */
+#endif
+
+#define MMAP_STREAM_DROP_CACHE 0x1  /* 处理完的输入页也从页缓存中丢掉 */
+
+struct mmap_stream_opts {
+    size_t window;      /* 映射窗口大小，默认 64 MiB */
+    size_t chunk;       /* 每次回调的大小，默认 1 MiB */
+    size_t readahead;   /* 游标前方预读的距离，默认 window / 2 */
+    unsigned flags;
+};
+
+/*
+ * 处理 [off, off + len) 这一块。返回 0 继续，返回其它值时流程停止，
+ * 并由 mmap_stream_fd 原样返回。
+ */
+typedef int (*mmap_stream_fn)(const char *data, size_t len, off_t off, void *arg);
+
+/*
+ * 把 in 变换后写到 out (长度相同)。返回值的含义同 mmap_stream_fn。
+ */
+typedef int (*mmap_transform_fn)(const char *in, char *out, size_t len, off_t off, void *arg);
+
+static inline void mmap_stream_defaults(struct mmap_stream_opts *o,
+                                        const struct mmap_stream_opts *user) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (user)
+        *o = *user;
+    else
+        memset(o, 0, sizeof(*o));
+    if (o->window == 0)
+        o->window = 64UL << 20;
+    if (o->chunk == 0)
+        o->chunk = 1UL << 20;
+    o->window = (o->window + page - 1) & ~(page - 1);
+    if (o->chunk > o->window)
+        o->chunk = o->window;
+    if (o->readahead == 0)
+        o->readahead = o->window / 2;
+}
+
+/**
+ * @brief 按块流式处理 fd 的 [start, start + len)
+ * @param fd 可读的文件描述符
+ * @param start 起始偏移，不需要页对齐
+ * @param len 处理的长度
+ * @param user_opts 为 NULL 时使用默认参数
+ * @param fn 每块调用一次，off 是块在文件中的偏移
+ * @return 全部处理完返回 0，fn 提前结束时返回它的返回值，出错返回 -1
+ */
+static inline int mmap_stream_fd(int fd, off_t start, size_t len,
+                                 const struct mmap_stream_opts *user_opts,
+                                 mmap_stream_fn fn, void *arg) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    struct mmap_stream_opts o;
+    off_t end = start + len;
+    off_t prefetched = start;
+    int ret = 0;
+
+    mmap_stream_defaults(&o, user_opts);
+    posix_fadvise(fd, start, len, POSIX_FADV_SEQUENTIAL);
+
+    off_t pos = start;
+    while (pos < end) {
+        // 窗口从页边界开始，装下 pos 之后整数个 chunk，块不会被窗口切开
+        off_t win_off = pos & ~(off_t)(page - 1);
+        size_t k = (o.window - (pos - win_off)) / o.chunk;
+        size_t win_len = (pos - win_off) + (k ? k : 1) * o.chunk;
+        if ((off_t)(win_off + win_len) > end)
+            win_len = end - win_off;
+
+        char *win = mmap(NULL, win_len, PROT_READ, MAP_SHARED, fd, win_off);
+        if (win == MAP_FAILED) {
+            perror("mmap failed");
+            return -1;
+        }
+        madvise(win, win_len, MADV_SEQUENTIAL);
+
+        off_t win_end = win_off + win_len;
+        off_t released = win_off;
+        while (pos < win_end) {
+            // 预读: 游标前方剩下不到一半时补到 readahead。窗口内的用
+            // madvise，超出窗口的部分直接交给页缓存
+            if (prefetched - pos < (off_t)o.readahead / 2 && prefetched < end) {
+                off_t from = (prefetched > pos ? prefetched : pos) & ~(off_t)(page - 1);
+                off_t to = pos + o.readahead;
+                if (to > end)
+                    to = end;
+                off_t split = to < win_end ? to : win_end;
+                if (from < split)
+                    madvise(win + (from - win_off), split - from, MADV_WILLNEED);
+                if (to > win_end) {
+                    off_t f = from > win_end ? from : win_end;
+                    posix_fadvise(fd, f, to - f, POSIX_FADV_WILLNEED);
+                }
+                prefetched = to;
+            }
+
+            size_t n = o.chunk;
+            if ((off_t)(pos + n) > win_end)
+                n = win_end - pos;
+            // 一次建好这一块的页表，省掉逐页缺页 (fault-around 一次只映射 16 页)
+            off_t pa = pos & ~(off_t)(page - 1);
+            madvise(win + (pa - win_off), pos + n - pa, MADV_POPULATE_READ);
+            ret = fn(win + (pos - win_off), n, pos, arg);
+            if (ret != 0)
+                break;
+            pos += n;
+
+            // 游标后方整页解除映射
+            off_t done = pos & ~(off_t)(page - 1);
+            if (done - released >= (off_t)o.chunk) {
+                madvise(win + (released - win_off), done - released, MADV_DONTNEED);
+                if (o.flags & MMAP_STREAM_DROP_CACHE)
+                    posix_fadvise(fd, released, done - released, POSIX_FADV_DONTNEED);
+                released = done;
+            }
+        }
+        munmap(win, win_len);
+        if ((o.flags & MMAP_STREAM_DROP_CACHE) && pos > released)
+            posix_fadvise(fd, released, pos - released, POSIX_FADV_DONTNEED);
+        if (ret != 0)
+            return ret;
+    }
+    return 0;
+}
+
+struct mmap_copy_ctx {
+    int out_fd;
+    char *buf;          /* 变换用的临时缓冲，一个 chunk */
+    mmap_transform_fn transform;
+    void *arg;
+    off_t synced;       /* 已发起回写的输出位置 */
+    size_t writeback;   /* 每写这么多就发起一次回写，限制脏页数量 */
+};
+
+static inline int mmap_copy_chunk(const char *data, size_t len, off_t off, void *p) {
+    struct mmap_copy_ctx *c = p;
+    const char *src = data;
+
+    if (c->transform) {
+        int ret = c->transform(data, c->buf, len, off, c->arg);
+        if (ret != 0)
+            return ret;
+        src = c->buf;
+    }
+    for (size_t done = 0; done < len; ) {
+        ssize_t n = pwrite(c->out_fd, src + done, len - done, off + done);
+        if (n <= 0) {
+            perror("pwrite failed");
+            return -1;
+        }
+        done += n;
+    }
+    // 不等回写完成，只是别让脏页一直堆到 dirty_ratio
+    if (off + (off_t)len - c->synced >= (off_t)c->writeback) {
+        sync_file_range(c->out_fd, c->synced, off + len - c->synced, SYNC_FILE_RANGE_WRITE);
+        c->synced = off + len;
+    }
+    return 0;
+}
+
+/**
+ * @brief 复制文件，可选逐块变换
+ * @param src 源文件
+ * @param dst 目标文件，会被创建或截断
+ * @param opts 为 NULL 时使用默认参数
+ * @param transform 为 NULL 时原样复制
+ * @return 成功返回 0，transform 提前结束时返回它的返回值，出错返回 -1
+ */
+static inline int mmap_copy_file(const char *src, const char *dst,
+                                 const struct mmap_stream_opts *opts,
+                                 mmap_transform_fn transform, void *arg) {
+    struct mmap_stream_opts o;
+    struct mmap_copy_ctx c = { .transform = transform, .arg = arg };
+    struct stat st;
+    int ret = -1;
+
+    mmap_stream_defaults(&o, opts);
+    int in = open(src, O_RDONLY);
+    if (in == -1) {
+        perror("open failed");
+        return -1;
+    }
+    c.out_fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (c.out_fd == -1) {
+        perror("open failed");
+        close(in);
+        return -1;
+    }
+    if (fstat(in, &st) == -1) {
+        perror("fstat failed");
+        goto out;
+    }
+    if (transform && !(c.buf = malloc(o.chunk)))
+        goto out;
+    c.writeback = o.window;
+
+    ret = mmap_stream_fd(in, 0, st.st_size, &o, mmap_copy_chunk, &c);
+out:
+    free(c.buf);
+    close(in);
+    if (close(c.out_fd) == -1 && ret == 0)
+        ret = -1;
+    return ret;
+}
+
+#endif // _MMAP_STREAM_H
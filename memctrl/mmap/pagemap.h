@@ -0,0 +1,350 @@
+#ifndef _PAGEMAP_H
+#define _PAGEMAP_H
+
+/*
+ * 批量读取 /proc/<pid>/pagemap 并关联 /proc/kpageflags
+ *
+ * test.c 里的 get_physical_address 每查一页就 open + pread + close 一次。
+ * 这里每次 pread 读出一整段虚拟地址 (最多 PAGEMAP_BATCH 页) 的表项，
+ * 把其中的 PFN 排序后按连续段读 kpageflags，最后按 VMA 汇总:
+ * 驻留、交换、THP/hugetlb、匿名/文件、KSM、零页以及每个 NUMA 节点上的页数。
+ * PFN 到节点的映射来自 /sys/devices/system/node/nodeN/memoryM，一次建表，
+ * 之后每页只是一次查表。
+ *
+ *     struct pagemap_ctx pm;
+ *     pagemap_open(&pm, pid);
+ *     pagemap_scan_vmas(&pm, print_vma, NULL);
+ *     pagemap_close(&pm);
+ *
+ * PFN 和 kpageflags 需要 CAP_SYS_ADMIN；没有权限时 PFN 读出来是 0，
+ * 只有 present/swap/file 等 pagemap 自带的位有效，flags_ok 为 0。
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/* pagemap 表项 */
+#define PM_PFN_MASK     ((1ULL << 55) - 1)
+#define PM_SOFT_DIRTY   (1ULL << 55)
+#define PM_EXCLUSIVE    (1ULL << 56)
+#define PM_FILE         (1ULL << 61)
+#define PM_SWAP         (1ULL << 62)
+#define PM_PRESENT      (1ULL << 63)
+
+/* kpageflags 位号，见 include/uapi/linux/kernel-page-flags.h */
+#define KPF_DIRTY       4
+#define KPF_LRU         5
+#define KPF_ACTIVE      6
+#define KPF_ANON        12
+#define KPF_HUGE        17
+#define KPF_UNEVICTABLE 18
+#define KPF_KSM         21
+#define KPF_THP         22
+#define KPF_ZERO_PAGE   24
+#define KPF_IDLE        25
+
+#define PAGEMAP_BATCH     (1UL << 19)  /* 每次 pread 的表项数，4 MiB，覆盖 2 GiB */
+#define PAGEMAP_KPF_GAP   64           /* PFN 间隔不超过这么多页时合并成一次 pread */
+#define PAGEMAP_MAX_NODES 64
+
+struct pagemap_summary {
+    uint64_t pages;         /* 扫描的虚拟页数 */
+    uint64_t present;
+    uint64_t swapped;
+    uint64_t file;          /* 文件页或共享匿名页 */
+    uint64_t exclusive;     /* 只被这个进程映射 */
+    uint64_t soft_dirty;
+    /* 以下来自 kpageflags，需要 flags_ok */
+    uint64_t anon;
+    uint64_t thp;
+    uint64_t hugetlb;
+    uint64_t ksm;
+    uint64_t zero;
+    uint64_t dirty;
+    uint64_t active;
+    uint64_t unevictable;
+    uint64_t idle;
+    uint64_t node_pages[PAGEMAP_MAX_NODES];
+};
+
+struct pagemap_vma {
+    uintptr_t start, end;
+    char perms[5];
+    unsigned long long offset;
+    char name[256];
+};
+
+struct pagemap_ctx {
+    pid_t pid;
+    int pagemap_fd;
+    int kpageflags_fd;      /* 打不开时为 -1 */
+    int flags_ok;           /* 读到了非 0 的 PFN */
+    size_t page_size;
+    uint64_t *entries;      /* PAGEMAP_BATCH 个 pagemap 表项 */
+    uint64_t *pfns;         /* 排序用 */
+    uint64_t *flags;        /* kpageflags 读缓冲 */
+    int16_t *block_node;    /* 内存块 -> 节点，-1 未知 */
+    size_t nr_blocks;
+    uint64_t pages_per_block;
+    int nr_nodes;
+    uint64_t kpf_reads;     /* 统计: kpageflags 的 pread 次数 */
+};
+
+/* 从 sysfs 建 PFN 所在内存块到节点的表 */
+static inline void pagemap_load_nodes(struct pagemap_ctx *pm) {
+    char path[128];
+    unsigned long long block_size = 0;
+    FILE *fp = fopen("/sys/devices/system/memory/block_size_bytes", "r");
+
+    pm->nr_nodes = 1;
+    if (!fp)
+        return;
+    if (fscanf(fp, "%llx", &block_size) != 1)
+        block_size = 0;
+    fclose(fp);
+    if (block_size < pm->page_size)
+        return;
+    pm->pages_per_block = block_size / pm->page_size;
+
+    for (int node = 0; node < PAGEMAP_MAX_NODES; node++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", node);
+        DIR *dir = opendir(path);
+        if (!dir)
+            continue;
+        struct dirent *de;
+        while ((de = readdir(dir)) != NULL) {
+            unsigned long block;
+            if (sscanf(de->d_name, "memory%lu", &block) != 1)
+                continue;
+            if (block >= pm->nr_blocks) {
+                size_t n = (block + 1) * 2;
+                int16_t *t = realloc(pm->block_node, n * sizeof(*t));
+                if (!t)
+                    break;
+                for (size_t i = pm->nr_blocks; i < n; i++)
+                    t[i] = -1;
+                pm->block_node = t;
+                pm->nr_blocks = n;
+            }
+            pm->block_node[block] = node;
+        }
+        closedir(dir);
+        if (node + 1 > pm->nr_nodes)
+            pm->nr_nodes = node + 1;
+    }
+}
+
+static inline int pagemap_pfn_node(const struct pagemap_ctx *pm, uint64_t pfn) {
+    if (!pm->pages_per_block)
+        return 0;
+    uint64_t block = pfn / pm->pages_per_block;
+    if (block >= pm->nr_blocks || pm->block_node[block] < 0)
+        return 0;
+    return pm->block_node[block];
+}
+
+/**
+ * @brief 打开 pid 的 pagemap
+ * @param pid 目标进程，0 表示自己
+ * @return 成功返回 0，失败返回 -1
+ */
+static inline int pagemap_open(struct pagemap_ctx *pm, pid_t pid) {
+    char path[64];
+
+    memset(pm, 0, sizeof(*pm));
+    pm->pid = pid;
+    pm->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    if (pid)
+        snprintf(path, sizeof(path), "/proc/%d/pagemap", (int)pid);
+    else
+        snprintf(path, sizeof(path), "/proc/self/pagemap");
+    pm->pagemap_fd = open(path, O_RDONLY);
+    if (pm->pagemap_fd == -1) {
+        perror("open pagemap failed");
+        return -1;
+    }
+    pm->kpageflags_fd = open("/proc/kpageflags", O_RDONLY);
+    pm->entries = malloc(PAGEMAP_BATCH * sizeof(uint64_t));
+    pm->pfns = malloc(PAGEMAP_BATCH * sizeof(uint64_t));
+    pm->flags = malloc(PAGEMAP_BATCH * sizeof(uint64_t));
+    if (!pm->entries || !pm->pfns || !pm->flags) {
+        free(pm->entries);
+        free(pm->pfns);
+        free(pm->flags);
+        close(pm->pagemap_fd);
+        if (pm->kpageflags_fd >= 0)
+            close(pm->kpageflags_fd);
+        return -1;
+    }
+    pagemap_load_nodes(pm);
+    return 0;
+}
+
+static inline void pagemap_close(struct pagemap_ctx *pm) {
+    close(pm->pagemap_fd);
+    if (pm->kpageflags_fd >= 0)
+        close(pm->kpageflags_fd);
+    free(pm->entries);
+    free(pm->pfns);
+    free(pm->flags);
+    free(pm->block_node);
+}
+
+static int pagemap_cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static inline void pagemap_account_flags(struct pagemap_ctx *pm, uint64_t pfn, uint64_t f,
+                                         struct pagemap_summary *s) {
+    s->anon += (f >> KPF_ANON) & 1;
+    s->thp += (f >> KPF_THP) & 1;
+    s->hugetlb += (f >> KPF_HUGE) & 1;
+    s->ksm += (f >> KPF_KSM) & 1;
+    s->zero += (f >> KPF_ZERO_PAGE) & 1;
+    s->dirty += (f >> KPF_DIRTY) & 1;
+    s->active += (f >> KPF_ACTIVE) & 1;
+    s->unevictable += (f >> KPF_UNEVICTABLE) & 1;
+    s->idle += (f >> KPF_IDLE) & 1;
+    s->node_pages[pagemap_pfn_node(pm, pfn)]++;
+}
+
+/*
+ * 排好序的 PFN 按间隔 <= PAGEMAP_KPF_GAP 合并成段，每段一次 pread。
+ * THP 和顺序分配的页几乎都是连续的，随机分散的 4 KiB 页也能合并掉一部分。
+ */
+static inline void pagemap_join_flags(struct pagemap_ctx *pm, size_t n,
+                                      struct pagemap_summary *s) {
+    qsort(pm->pfns, n, sizeof(uint64_t), pagemap_cmp_u64);
+
+    for (size_t i = 0; i < n; ) {
+        uint64_t lo = pm->pfns[i], hi = lo;
+        size_t j = i + 1;
+        while (j < n && pm->pfns[j] - hi <= PAGEMAP_KPF_GAP &&
+               pm->pfns[j] - lo < PAGEMAP_BATCH)
+            hi = pm->pfns[j++];
+
+        size_t cnt = hi - lo + 1;
+        ssize_t got = pread(pm->kpageflags_fd, pm->flags, cnt * sizeof(uint64_t),
+                            lo * sizeof(uint64_t));
+        pm->kpf_reads++;
+        for (size_t k = i; k < j; k++) {
+            uint64_t idx = pm->pfns[k] - lo;
+            uint64_t f = (ssize_t)((idx + 1) * sizeof(uint64_t)) <= got ? pm->flags[idx] : 0;
+            pagemap_account_flags(pm, pm->pfns[k], f, s);
+        }
+        i = j;
+    }
+}
+
+/**
+ * @brief 扫描 [start, end)，结果累加到 s
+ * @return 成功返回 0，失败返回 -1
+ */
+static inline int pagemap_scan_range(struct pagemap_ctx *pm, uintptr_t start, uintptr_t end,
+                                     struct pagemap_summary *s) {
+    uintptr_t vpn = start / pm->page_size, vpn_end = (end + pm->page_size - 1) / pm->page_size;
+
+    while (vpn < vpn_end) {
+        size_t want = vpn_end - vpn < PAGEMAP_BATCH ? vpn_end - vpn : PAGEMAP_BATCH;
+        ssize_t got = pread(pm->pagemap_fd, pm->entries, want * sizeof(uint64_t),
+                            (off_t)(vpn * sizeof(uint64_t)));
+        if (got <= 0)
+            return got == 0 ? 0 : -1;
+        size_t n = got / sizeof(uint64_t), npfn = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            uint64_t e = pm->entries[i];
+            s->pages++;
+            if (e & PM_FILE)
+                s->file++;
+            if (e & PM_SOFT_DIRTY)
+                s->soft_dirty++;
+            if (e & PM_SWAP)
+                s->swapped++;
+            if (!(e & PM_PRESENT))
+                continue;
+            s->present++;
+            if (e & PM_EXCLUSIVE)
+                s->exclusive++;
+            if (e & PM_PFN_MASK)
+                pm->pfns[npfn++] = e & PM_PFN_MASK;
+        }
+        if (npfn) {
+            pm->flags_ok = 1;
+            if (pm->kpageflags_fd >= 0)
+                pagemap_join_flags(pm, npfn, s);
+        }
+        vpn += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief 按 /proc/<pid>/maps 逐个 VMA 扫描
+ * @param fn 每个 VMA 调用一次，返回非 0 时停止
+ * @return 成功返回 0，fn 停止时返回它的返回值，失败返回 -1
+ */
+static inline int pagemap_scan_vmas(struct pagemap_ctx *pm,
+                                    int (*fn)(const struct pagemap_vma *vma,
+                                              const struct pagemap_summary *s, void *arg),
+                                    void *arg) {
+    char path[64], line[512];
+    int ret = 0;
+
+    if (pm->pid)
+        snprintf(path, sizeof(path), "/proc/%d/maps", (int)pm->pid);
+    else
+        snprintf(path, sizeof(path), "/proc/self/maps");
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        perror("open maps failed");
+        return -1;
+    }
+    while (ret == 0 && fgets(line, sizeof(line), fp)) {
+        struct pagemap_vma vma = { 0 };
+        struct pagemap_summary s;
+        unsigned long long start, end;
+        int name_off = 0;
+
+        if (sscanf(line, "%llx-%llx %4s %llx %*s %*s %n", &start, &end, vma.perms,
+                   &vma.offset, &name_off) < 4)
+            continue;
+        vma.start = start;
+        vma.end = end;
+        if (name_off > 0)
+            snprintf(vma.name, sizeof(vma.name), "%.*s", (int)strcspn(line + name_off, "\n"),
+                     line + name_off);
+        // [vsyscall] 在用户地址空间之外，pagemap 读不到
+        if (strcmp(vma.name, "[vsyscall]") == 0)
+            continue;
+
+        memset(&s, 0, sizeof(s));
+        if (pagemap_scan_range(pm, vma.start, vma.end, &s) == -1) {
+            ret = -1;
+            break;
+        }
+        ret = fn(&vma, &s, arg);
+    }
+    fclose(fp);
+    return ret;
+}
+
+/**
+ * @brief 把 b 累加到 a
+ */
+static inline void pagemap_summary_add(struct pagemap_summary *a, const struct pagemap_summary *b) {
+    const uint64_t *src = (const uint64_t *)b;
+    uint64_t *dst = (uint64_t *)a;
+    for (size_t i = 0; i < sizeof(*a) / sizeof(uint64_t); i++)
+        dst[i] += src[i];
+}
+
+#endif // _PAGEMAP_H
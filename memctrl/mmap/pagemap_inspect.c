@@ -0,0 +1,113 @@
+/*
+ * 按 VMA 统计进程的内存布局: 驻留、交换、THP/hugetlb、匿名/文件以及 NUMA 分布
+ *
+ * 用法: sudo ./pagemap_inspect [-a] [-i interval_s] [-n count] [pid]
+ *
+ *   -a  也列出没有驻留页的 VMA
+ *   -i  每隔 interval_s 秒重新采样一次 (默认只采一次)
+ *   -n  采样次数，配合 -i 使用，0 表示一直采
+ *
+ * 大小单位都是 KiB。每次采样最后打印总计和这次扫描本身的耗时，方便判断
+ * 对大进程能以多高的频率采样。
+ */
+#include "pagemap.h"
+#include <time.h>
+
+struct totals {
+    struct pagemap_summary sum;
+    int all;
+    int nr_nodes;
+    unsigned long vmas;
+};
+
+static unsigned long kb(uint64_t pages) {
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void print_nodes(const struct pagemap_summary *s, int nr_nodes) {
+    int first = 1;
+    for (int n = 0; n < nr_nodes; n++) {
+        if (!s->node_pages[n])
+            continue;
+        printf("%sN%d=%lu", first ? "" : ",", n, kb(s->node_pages[n]));
+        first = 0;
+    }
+    if (first)
+        printf("-");
+}
+
+static int print_vma(const struct pagemap_vma *vma, const struct pagemap_summary *s, void *arg) {
+    struct totals *t = arg;
+
+    t->vmas++;
+    pagemap_summary_add(&t->sum, s);
+    if (!t->all && !s->present && !s->swapped)
+        return 0;
+    printf("%012lx-%012lx %s %10lu %10lu %8lu %5.1f %8lu %10lu %10lu %10lu ",
+           (unsigned long)vma->start, (unsigned long)vma->end, vma->perms, kb(s->pages),
+           kb(s->present), kb(s->swapped), s->present ? 100.0 * s->thp / s->present : 0.0,
+           kb(s->hugetlb), kb(s->anon), kb(s->file), kb(s->exclusive));
+    print_nodes(s, t->nr_nodes);
+    printf(" %s\n", vma->name);
+    return 0;
+}
+
+static int sample(pid_t pid, int all) {
+    struct pagemap_ctx pm;
+    struct totals t = { .all = all };
+    struct timespec t0, t1;
+
+    if (pagemap_open(&pm, pid) == -1)
+        return -1;
+    t.nr_nodes = pm.nr_nodes;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    printf("%-25s %-4s %10s %10s %8s %5s %8s %10s %10s %10s %s\n", "vma", "perm", "size",
+           "rss", "swap", "thp%", "hugetlb", "anon", "file", "excl", "nodes name");
+    int ret = pagemap_scan_vmas(&pm, print_vma, &t);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    const struct pagemap_summary *s = &t.sum;
+    printf("total: %lu vmas, size %lu, rss %lu, swap %lu, thp %lu, hugetlb %lu, anon %lu, "
+           "file %lu, ksm %lu, zero %lu, dirty %lu, active %lu, nodes ",
+           t.vmas, kb(s->pages), kb(s->present), kb(s->swapped), kb(s->thp), kb(s->hugetlb),
+           kb(s->anon), kb(s->file), kb(s->ksm), kb(s->zero), kb(s->dirty), kb(s->active));
+    print_nodes(s, t.nr_nodes);
+    printf("\nscan: %.2f ms, %lu kpageflags reads%s\n",
+           (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6,
+           (unsigned long)pm.kpf_reads,
+           pm.flags_ok ? "" : " (no PFNs: run as root for kpageflags columns)");
+    pagemap_close(&pm);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    int all = 0, opt;
+    double interval = 0;
+    long count = -1;
+
+    while ((opt = getopt(argc, argv, "ai:n:")) != -1) {
+        switch (opt) {
+        case 'a': all = 1; break;
+        case 'i': interval = atof(optarg); break;
+        case 'n': count = atol(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-a] [-i interval_s] [-n count] [pid]\n", argv[0]);
+            return 1;
+        }
+    }
+    pid_t pid = optind < argc ? atoi(argv[optind]) : 0;
+    if (count < 0)
+        count = interval > 0 ? 0 : 1;
+
+    for (long i = 0; count == 0 || i < count; i++) {
+        if (i > 0) {
+            struct timespec ts = { (time_t)interval, (long)((interval - (time_t)interval) * 1e9) };
+            nanosleep(&ts, NULL);
+            printf("\n");
+        }
+        if (sample(pid, all) == -1)
+            return 1;
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -8,10 +8,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 extern void *mmap_remap(void *addr, size_t size);
+extern void *mmap_remap_ex(void *addr, size_t size, unsigned flags);
+extern int mmap_remap_wait(void *addr, struct mmap_remap_stats *stats);
+extern void *mmap_remap_node(void *addr, size_t size, int node, unsigned flags,
+                             struct mmap_node_stats *stats);
 extern int file_mmap_write(const char *filename, size_t offset, char *content);
+extern int file_mmap_write_ex(const char *filename, size_t offset,
+                              char *content, unsigned flags);
 
 #define PAGE_SIZE 4096
 #define LARGE_SIZE (1024 * 1024) // 1MB
@@ -41,6 +48,34 @@ uint64_t get_physical_address(void *virtual_address) {
   return (entry & ((1ULL << 54) - 1)) * PAGE_SIZE;
 }
 
+// /proc/kpageflags 中 va 所在物理页的标志位，不在内存中返回 0
+uint64_t get_page_flags(void *virtual_address) {
+  uint64_t phys = get_physical_address(virtual_address), flags = 0;
+  int fd = open("/proc/kpageflags", O_RDONLY);
+
+  if (phys == 0 || fd < 0 ||
+      pread(fd, &flags, sizeof(flags), phys / PAGE_SIZE * sizeof(flags)) !=
+          sizeof(flags))
+    flags = 0;
+  if (fd >= 0)
+    close(fd);
+  return flags;
+}
+
+#define KPF_HUGE (1ULL << 17)
+#define KPF_THP (1ULL << 22)
+
+int thp_disabled() {
+  char buf[128] = "";
+  FILE *fp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+  if (!fp)
+    return 1;
+  if (!fgets(buf, sizeof(buf), fp))
+    buf[0] = '\0';
+  fclose(fp);
+  return strstr(buf, "[never]") != NULL;
+}
+
 // Helper function to create test files
 void create_test_file(const char *filename, size_t size) {
   FILE *fp = fopen(filename, "wb");
@@ -88,6 +123,319 @@ void test_mmap_remap() {
   munmap(addr2, size);
 }
 
+static double elapsed_ms(struct timespec *t0) {
+  struct timespec t1;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0->tv_sec) * 1e3 + (t1.tv_nsec - t0->tv_nsec) / 1e6;
+}
+
+void test_mmap_remap_move() {
+  printf("\n=== Testing mmap_remap_ex(MMAP_REMAP_MOVE) ===\n");
+
+  size_t size = PAGE_SIZE * 4;
+  unsigned char *addr1 = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(addr1 != MAP_FAILED);
+  for (size_t i = 0; i < size; i++)
+    addr1[i] = (unsigned char)(i * 7);
+  uint64_t phys[4];
+  for (int i = 0; i < 4; i++)
+    phys[i] = get_physical_address(addr1 + i * PAGE_SIZE);
+
+  unsigned char *addr2 = mmap_remap_ex(addr1, size, MMAP_REMAP_MOVE);
+  assert(addr2 != NULL);
+  assert(addr1 != addr2);
+
+  // 同一批物理页，只是换了虚拟地址
+  for (int i = 0; i < 4; i++)
+    assert(get_physical_address(addr2 + i * PAGE_SIZE) == phys[i]);
+  for (size_t i = 0; i < size; i++)
+    assert(addr2[i] == (unsigned char)(i * 7));
+
+  // 旧区域已经释放
+  unsigned char vec[4];
+  assert(mincore(addr1, size, vec) == -1 && errno == ENOMEM);
+
+  // 未知 flags
+  assert(mmap_remap_ex(addr2, size, 0x80) == NULL && errno == EINVAL);
+  munmap(addr2, size);
+
+  // 大区域：复制模式和移动模式的耗时
+  size_t big = 256UL * 1024 * 1024;
+  for (int move = 0; move <= 1; move++) {
+    char *src = mmap(NULL, big, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(src != MAP_FAILED);
+    memset(src, 0x5A, big);
+
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    char *dst = mmap_remap_ex(src, big, move ? MMAP_REMAP_MOVE : MMAP_REMAP_COPY);
+    double ms = elapsed_ms(&t0);
+    assert(dst != NULL);
+    assert(dst[0] == 0x5A && dst[big - 1] == 0x5A);
+    printf("%s remap of %zu MB: %.2f ms\n", move ? "move" : "copy",
+           big >> 20, ms);
+    munmap(dst, big);
+  }
+}
+
+void test_mmap_remap_huge() {
+  printf("\n=== Testing mmap_remap_ex with huge pages ===\n");
+
+  size_t hps = huge_page_size();
+  size_t size = hps * 4;
+  unsigned char *addr1 = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(addr1 != MAP_FAILED);
+  memset(addr1, 0x3C, size);
+
+  // 复制到 THP 区域：大页对齐，数据完整，每个大页都由 THP 支撑
+  unsigned char *addr2 = mmap_remap_ex(addr1, size, MMAP_REMAP_THP);
+  assert(addr2 != NULL);
+  assert((uintptr_t)addr2 % hps == 0);
+  for (size_t i = 0; i < size; i++)
+    assert(addr2[i] == 0x3C);
+  if (thp_disabled()) {
+    printf("THP disabled, skipping backing check\n");
+  } else {
+    int thp = 0;
+    for (size_t off = 0; off < size; off += hps)
+      if (get_page_flags(addr2 + off) & KPF_THP)
+        thp++;
+    printf("THP copy: %d/%zu huge pages\n", thp, size / hps);
+    assert(thp > 0);
+  }
+
+  // 移动到对齐地址，大页原样保留
+  uint64_t phys = get_physical_address(addr2);
+  unsigned char *addr3 = mmap_remap_ex(addr2, size, MMAP_REMAP_MOVE | MMAP_REMAP_THP);
+  assert(addr3 != NULL && addr3 != addr2);
+  assert((uintptr_t)addr3 % hps == 0);
+  assert(get_physical_address(addr3) == phys);
+  assert(addr3[0] == 0x3C && addr3[size - 1] == 0x3C);
+  if (!thp_disabled())
+    assert(get_page_flags(addr3) & KPF_THP);
+
+  // hugetlb 需要预留页，没有时只检查失败不破坏原区域
+  unsigned char *addr4 = mmap_remap_ex(addr3, size, MMAP_REMAP_HUGETLB);
+  if (addr4 == NULL) {
+    printf("No hugetlb pages reserved, skipping MAP_HUGETLB\n");
+    assert(addr3[0] == 0x3C);
+    munmap(addr3, size);
+  } else {
+    assert(addr4[0] == 0x3C && addr4[size - 1] == 0x3C);
+    assert(get_page_flags(addr4) & KPF_HUGE);
+    munmap(addr4, size);
+  }
+
+  // HUGETLB 不能和 MOVE/THP 组合
+  assert(mmap_remap_ex(NULL, size, MMAP_REMAP_HUGETLB | MMAP_REMAP_MOVE) == NULL &&
+         errno == EINVAL);
+
+  // tmpfs 上的文件映射，huge=advise 时页缓存可以用大页
+  char buf[] = "HUGE_FILE_CONTENT";
+  const char *shm_file = "/dev/shm/mmap_test_thp";
+  assert(file_mmap_write_ex(shm_file, hps, buf, FILE_MMAP_THP) == 0);
+  FILE *fp = fopen(shm_file, "rb");
+  char check[sizeof(buf)] = "";
+  assert(fp && fseek(fp, hps, SEEK_SET) == 0);
+  assert(fread(check, 1, strlen(buf), fp) == strlen(buf));
+  assert(memcmp(check, buf, strlen(buf)) == 0);
+  fclose(fp);
+  unlink(shm_file);
+}
+
+static size_t resident_pages(void *addr, size_t size) {
+  size_t n = size / PAGE_SIZE, cnt = 0;
+  unsigned char *vec = malloc(n);
+  assert(vec && mincore(addr, size, vec) == 0);
+  for (size_t i = 0; i < n; i++)
+    cnt += vec[i] & 1;
+  free(vec);
+  return cnt;
+}
+
+void test_mmap_remap_lazy() {
+  printf("\n=== Testing mmap_remap_ex(MMAP_REMAP_LAZY) ===\n");
+
+  int uffd = lazy_uffd_open();
+  if (uffd == -1)
+    printf("userfaultfd unavailable, LAZY falls back to copy\n");
+  else
+    close(uffd);
+  struct mmap_remap_stats st;
+
+  // 稠密区域：每页都有数据，用户态和内核态的首次访问都能拿到旧内容
+  size_t size = 64UL << 20;
+  unsigned char *addr1 = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(addr1 != MAP_FAILED);
+  for (size_t i = 0; i < size; i += PAGE_SIZE) {
+    addr1[i] = (unsigned char)(i / PAGE_SIZE * 13);
+    addr1[i + PAGE_SIZE - 1] = 0xEE;
+  }
+  unsigned char *addr2 = mmap_remap_ex(addr1, size, MMAP_REMAP_LAZY);
+  assert(addr2 != NULL && addr2 != addr1);
+
+  int fds[2];
+  unsigned char *mid = addr2 + size / 2;
+  assert(pipe(fds) == 0 && write(fds[1], "lazy", 4) == 4);
+  assert(read(fds[0], mid + 100, 4) == 4);
+  close(fds[0]);
+  close(fds[1]);
+  for (size_t i = 0; i < size; i += PAGE_SIZE) {
+    assert(addr2[i] == (unsigned char)(i / PAGE_SIZE * 13));
+    assert(addr2[i + PAGE_SIZE - 1] == 0xEE);
+  }
+  assert(memcmp(mid + 100, "lazy", 4) == 0);
+
+  mmap_remap_wait(addr2, &st);
+  printf("dense: %lu faults, %lu pages on fault, %lu prefetched\n",
+         st.faults, st.fault_pages, st.prefetch_pages);
+  if (uffd != -1) {
+    assert(!st.aborted);
+    assert(st.fault_pages + st.prefetch_pages == size / PAGE_SIZE);
+  }
+  // 复制完成后旧区域释放，新区域是普通映射
+  unsigned char vec[1];
+  assert(mincore(addr1, PAGE_SIZE, vec) == -1 && errno == ENOMEM);
+  addr2[0] = 1;
+  munmap(addr2, size);
+
+  // 稀疏区域：1 GiB 里每 4 MiB 写一页，只复制这些页
+  size_t big = 1UL << 30, stride = 4UL << 20;
+  for (int lazy = 1; lazy >= 0; lazy--) {
+    char *src = mmap(NULL, big, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    assert(src != MAP_FAILED);
+    for (size_t off = 0; off < big; off += stride)
+      src[off] = (char)(1 + off / stride);
+
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    char *dst = mmap_remap_ex(src, big, lazy ? MMAP_REMAP_LAZY : MMAP_REMAP_COPY);
+    double ms = elapsed_ms(&t0);
+    assert(dst != NULL);
+    for (size_t off = 0; off < big; off += stride)
+      assert(dst[off] == (char)(1 + off / stride));
+    assert(dst[PAGE_SIZE] == 0 && dst[big - 1] == 0);
+    mmap_remap_wait(dst, &st);
+    printf("%s remap of %zu MB sparse: %.2f ms to return, %.2f ms total, "
+           "%zu pages resident\n", lazy ? "lazy" : "copy", big >> 20, ms,
+           elapsed_ms(&t0), resident_pages(dst, big));
+    if (lazy && uffd != -1) {
+      assert(st.fault_pages + st.prefetch_pages == big / stride);
+      // 有数据的页 + 读过的两个 0 页
+      assert(resident_pages(dst, big) <= big / stride + 2);
+    }
+    munmap(dst, big);
+  }
+
+  // 复制结束前释放新区域：后台线程放弃并释放旧区域
+  addr1 = mmap(NULL, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(addr1 != MAP_FAILED);
+  memset(addr1, 0x11, size);
+  addr2 = mmap_remap_ex(addr1, size, MMAP_REMAP_LAZY);
+  assert(addr2 != NULL);
+  munmap(addr2, size);
+  mmap_remap_wait(addr2, &st);
+  printf("early munmap: aborted=%d after %lu prefetched\n", st.aborted, st.prefetch_pages);
+  assert(mincore(addr1, PAGE_SIZE, vec) == -1 && errno == ENOMEM);
+
+  // 复制中途 ioctl 出错但新区域还在：剩下的页直接 memcpy，数据不丢。
+  // 把 uffd 换成 /dev/null，之后的 UFFDIO_COPY 都会失败 (ENOTTY)
+  addr1 = mmap(NULL, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(addr1 != MAP_FAILED);
+  for (size_t i = 0; i < size; i += PAGE_SIZE)
+    addr1[i] = (unsigned char)(i / PAGE_SIZE * 7 + 1);
+  addr2 = mmap_remap_ex(addr1, size, MMAP_REMAP_LAZY);
+  assert(addr2 != NULL);
+  if (uffd != -1) {
+    int devnull = open("/dev/null", O_RDONLY);
+    assert(devnull != -1);
+    pthread_mutex_lock(&lazy_lock);
+    for (struct lazy_remap *lr = lazy_list; lr; lr = lr->next)
+      if (lr->new_addr == (char *)addr2)
+        assert(dup2(devnull, lr->uffd) == lr->uffd);
+    pthread_mutex_unlock(&lazy_lock);
+    close(devnull);
+  }
+  mmap_remap_wait(addr2, &st);
+  printf("ioctl error: aborted=%d, %lu prefetched, %lu copied by memcpy\n",
+         st.aborted, st.prefetch_pages, st.fallback_pages);
+  if (uffd != -1)
+    assert(!st.aborted && st.fallback_pages > 0);
+  for (size_t i = 0; i < size; i += PAGE_SIZE)
+    assert(addr2[i] == (unsigned char)(i / PAGE_SIZE * 7 + 1));
+  assert(mincore(addr1, PAGE_SIZE, vec) == -1 && errno == ENOMEM);
+  munmap(addr2, size);
+
+  assert(mmap_remap_ex(NULL, size, MMAP_REMAP_LAZY | MMAP_REMAP_MOVE) == NULL &&
+         errno == EINVAL);
+}
+
+static int max_node() {
+  int node = 0;
+  char path[64];
+  for (int n = 1; n < 1024; n++) {
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", n);
+    if (access(path, F_OK) == 0)
+      node = n;
+  }
+  return node;
+}
+
+void test_mmap_remap_node() {
+  printf("\n=== Testing mmap_remap_node ===\n");
+
+  size_t size = 64UL << 20, npages = size / PAGE_SIZE;
+  struct mmap_node_stats st;
+  int last = max_node();
+  unsigned char *addr1 = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(addr1 != MAP_FAILED);
+  memset(addr1, 0x42, size);
+
+  // 复制到节点 0：每一页都是新分配在节点 0 上的
+  unsigned char *addr2 = mmap_remap_node(addr1, size, 0, MMAP_REMAP_COPY, &st);
+  assert(addr2 != NULL && addr2 != addr1);
+  assert(addr2[0] == 0x42 && addr2[size - 1] == 0x42);
+  assert(st.pages == npages && st.moved == npages && st.failed == 0);
+  printf("copy to node 0: %lu pages, %.1f MB/s\n", st.moved, st.mb_per_sec);
+
+  // 移动到最后一个节点：单节点机器上已经就位，一页都不用搬
+  unsigned char *addr3 = mmap_remap_node(addr2, size, last, MMAP_REMAP_MOVE, &st);
+  assert(addr3 != NULL && addr3 != addr2);
+  assert(addr3[0] == 0x42 && addr3[size - 1] == 0x42);
+  assert(st.pages == npages && st.moved + st.failed == (last ? npages : 0));
+  assert(st.error == 0);
+  printf("move to node %d: %lu/%lu pages moved, %lu failed, %.1f MB/s\n",
+         last, st.moved, st.pages, st.failed, st.mb_per_sec);
+
+  // 之后新分配的页也在目标节点上
+  unsigned char *addr4 = mmap_remap_node(NULL, PAGE_SIZE * 4, last, 0, &st);
+  assert(addr4 != NULL);
+  memset(addr4, 1, PAGE_SIZE * 4);
+  void *pages[4];
+  int status[4];
+  for (int i = 0; i < 4; i++)
+    pages[i] = addr4 + i * PAGE_SIZE;
+  if (syscall(SYS_move_pages, 0, 4, pages, NULL, status, 0) == 0)
+    for (int i = 0; i < 4; i++)
+      assert(status[i] == last);
+  munmap(addr4, PAGE_SIZE * 4);
+
+  // 不存在的节点和不支持的 flags：失败且原区域不变
+  assert(mmap_remap_node(addr3, size, last + 1, 0, &st) == NULL && errno == EINVAL);
+  assert(mmap_remap_node(addr3, size, -1, 0, &st) == NULL && errno == EINVAL);
+  assert(mmap_remap_node(addr3, size, 0, MMAP_REMAP_LAZY, &st) == NULL && errno == EINVAL);
+  assert(addr3[0] == 0x42);
+  munmap(addr3, size);
+}
+
 void test_file_operations(const char *filename, size_t filesize) {
   printf("\n=== Testing file operations for %s (size: %zu) ===\n", filename,
          filesize);
@@ -145,6 +493,10 @@ int main() {
 
   // Test 1: Page table entry validation
   test_mmap_remap();
+  test_mmap_remap_move();
+  test_mmap_remap_huge();
+  test_mmap_remap_lazy();
+  test_mmap_remap_node();
   printf("Remapping Passed.\n");
   // Test 2: Memory-file synchronization tests
   const char *empty_file = "empty.txt";
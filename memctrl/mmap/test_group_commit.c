@@ -0,0 +1,154 @@
+#include "group_commit.h"
+#include <assert.h>
+
+#define TEST_FILE "group_commit_test.bin"
+#define RECORD 64
+#define NUM_THREADS 8
+#define NUM_WRITES 2000
+#define WAIT_EVERY 50
+
+static struct group_commit gc;
+static uint64_t max_wait_ns[NUM_THREADS];
+
+static void fill_record(char *buf, long tid, long i) {
+  memset(buf, 'a' + tid, RECORD);
+  memcpy(buf, &i, sizeof(i));
+}
+
+static size_t file_size(const char *filename) {
+  struct stat st;
+  assert(stat(filename, &st) == 0);
+  return st.st_size;
+}
+
+// 每个线程写自己的一段，奇数线程每 WAIT_EVERY 次写入等一次落盘
+static void *writer(void *arg) {
+  long tid = (long)arg;
+  char rec[RECORD];
+  uint64_t last = 0;
+
+  for (long i = 0; i < NUM_WRITES; i++) {
+    fill_record(rec, tid, i);
+    size_t off = ((size_t)tid * NUM_WRITES + i) * RECORD;
+    uint64_t seq = gc_write(&gc, off, rec, RECORD);
+    assert(seq > last);
+    last = seq;
+    if ((tid & 1) && i % WAIT_EVERY == 0) {
+      uint64_t t0 = gc_now_ns();
+      assert(gc_wait(&gc, seq) == 0);
+      uint64_t ns = gc_now_ns() - t0;
+      if (ns > max_wait_ns[tid])
+        max_wait_ns[tid] = ns;
+    }
+  }
+  assert(gc_wait(&gc, last) == 0);
+  return NULL;
+}
+
+void test_concurrent_writers() {
+  printf("\n=== Testing group commit with %d writers ===\n", NUM_THREADS);
+
+  const unsigned interval_ms = 5;
+  assert(gc_open(&gc, TEST_FILE, O_CREAT | O_TRUNC, interval_ms, 1 << 20) == 0);
+
+  pthread_t threads[NUM_THREADS];
+  uint64_t t0 = gc_now_ns();
+  for (long i = 0; i < NUM_THREADS; i++)
+    pthread_create(&threads[i], NULL, writer, (void *)i);
+  for (int i = 0; i < NUM_THREADS; i++)
+    pthread_join(threads[i], NULL);
+  double ms = (gc_now_ns() - t0) / 1e6;
+
+  long writes = NUM_THREADS * NUM_WRITES;
+  assert(gc.durable_seq == (uint64_t)writes);
+  // 很多次写入共用一次刷盘
+  assert(gc.flushes > 0 && gc.flushes < (unsigned long)writes / 4);
+  uint64_t worst = 0;
+  for (int i = 0; i < NUM_THREADS; i++)
+    if (max_wait_ns[i] > worst)
+      worst = max_wait_ns[i];
+  printf("%ld writes in %.2f ms, %lu flushes (%.1f writes/flush), "
+         "avg flush %.2f ms, worst wait %.2f ms\n",
+         writes, ms, gc.flushes, (double)writes / gc.flushes,
+         gc.flush_ns / 1e6 / gc.flushes, worst / 1e6);
+  assert(gc_close(&gc) == 0);
+
+  assert(file_size(TEST_FILE) == (size_t)writes * RECORD);
+  int fd = open(TEST_FILE, O_RDONLY);
+  char rec[RECORD], got[RECORD];
+  for (long t = 0; t < NUM_THREADS; t++)
+    for (long i = 0; i < NUM_WRITES; i += 101) {
+      fill_record(rec, t, i);
+      assert(pread(fd, got, RECORD, ((size_t)t * NUM_WRITES + i) * RECORD) == RECORD);
+      assert(memcmp(got, rec, RECORD) == 0);
+    }
+  close(fd);
+}
+
+void test_size_threshold() {
+  printf("\n=== Testing group commit size threshold ===\n");
+
+  // 间隔很长，只能靠字节阈值触发
+  assert(gc_open(&gc, TEST_FILE, O_CREAT | O_TRUNC, 60 * 1000, 4 * RECORD) == 0);
+  char rec[RECORD];
+  uint64_t seq = 0;
+  size_t off;
+  for (int i = 0; i < 4; i++) {
+    fill_record(rec, 0, i);
+    seq = gc_append(&gc, rec, RECORD, &off);
+    assert(seq == (uint64_t)i + 1 && off == (size_t)i * RECORD);
+  }
+  uint64_t t0 = gc_now_ns();
+  assert(gc_wait(&gc, seq) == 0);
+  assert(gc_now_ns() - t0 < 1000000000ULL);
+  assert(gc.flushes == 1);
+
+  // 不够阈值的写入在 close 时刷完
+  seq = gc_append(&gc, rec, RECORD, NULL);
+  assert(gc.durable_seq < seq);
+  assert(gc_close(&gc) == 0);
+  assert(file_size(TEST_FILE) == 5 * RECORD);
+  printf("threshold flush and flush-on-close passed\n");
+}
+
+void test_vs_sync_commit() {
+  printf("\n=== Comparing with synchronous commit ===\n");
+
+  const int n = 2000;
+  char rec[RECORD];
+  struct mapped_file *mf = mapped_file_open(TEST_FILE, O_CREAT | O_TRUNC);
+  assert(mf != NULL);
+  uint64_t t0 = gc_now_ns();
+  for (int i = 0; i < n; i++) {
+    fill_record(rec, 0, i);
+    assert(mapped_file_append(mf, rec, RECORD) >= 0);
+    assert(mapped_file_commit(mf) == 0);
+  }
+  double ms_sync = (gc_now_ns() - t0) / 1e6;
+  assert(mapped_file_close(mf) == 0);
+
+  assert(gc_open(&gc, TEST_FILE, O_CREAT | O_TRUNC, 2, 1 << 20) == 0);
+  t0 = gc_now_ns();
+  uint64_t seq = 0;
+  for (int i = 0; i < n; i++) {
+    fill_record(rec, 0, i);
+    seq = gc_append(&gc, rec, RECORD, NULL);
+    assert(seq != 0);
+  }
+  assert(gc_wait(&gc, seq) == 0);
+  double ms_group = (gc_now_ns() - t0) / 1e6;
+  unsigned long flushes = gc.flushes;
+  assert(gc_close(&gc) == 0);
+
+  printf("%d appends: commit each %.2f ms, group commit %.2f ms (%lu flushes)\n",
+         n, ms_sync, ms_group, flushes);
+}
+
+int main() {
+  test_concurrent_writers();
+  test_size_threshold();
+  test_vs_sync_commit();
+  unlink(TEST_FILE);
+  printf("\nAll group commit tests passed.\n");
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include "impl.c"
+#include "mapped_file.h"
+#include <assert.h>
+#include <stdint.h>
+#include <time.h>
+
+#define PAGE_SIZE 4096
+#define TEST_FILE "mapped_file_test.bin"
+#define RECORD 64
+
+static double elapsed_ms(struct timespec *t0) {
+  struct timespec t1;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0->tv_sec) * 1e3 + (t1.tv_nsec - t0->tv_nsec) / 1e6;
+}
+
+static void fill_record(char *buf, long i) {
+  memset(buf, 'a' + i % 26, RECORD);
+  int n = snprintf(buf, RECORD, "record-%ld", i);
+  buf[n] = '-'; // file_mmap_write 按 strlen 取长度，不能留 '\0'
+}
+
+static size_t file_size(const char *filename) {
+  struct stat st;
+  assert(stat(filename, &st) == 0);
+  return st.st_size;
+}
+
+void test_append_and_grow() {
+  printf("\n=== Testing mapped_file append and growth ===\n");
+
+  struct mapped_file *mf = mapped_file_open(TEST_FILE, O_CREAT | O_TRUNC);
+  assert(mf != NULL);
+  assert(mf->size == 0 && mf->cap == MAPPED_FILE_MIN_CAP);
+
+  // 5 MiB 的追加写，容量要翻倍三次
+  long n = 5 * 1024 * 1024 / RECORD;
+  char rec[RECORD];
+  for (long i = 0; i < n; i++) {
+    fill_record(rec, i);
+    assert(mapped_file_append(mf, rec, RECORD) == i * RECORD);
+  }
+  assert(mf->size == (size_t)n * RECORD);
+  assert(mf->grows == 3 && mf->cap == 8 * MAPPED_FILE_MIN_CAP);
+  // 顺序写只留下一个脏区间
+  assert(mf->nr_dirty == 1);
+  assert(mapped_file_commit(mf) == 0);
+  assert(mf->nr_dirty == 0 && mf->commits == 1);
+  assert(mapped_file_close(mf) == 0);
+
+  // 文件被截回逻辑大小，内容和写入的一致
+  assert(file_size(TEST_FILE) == (size_t)n * RECORD);
+  int fd = open(TEST_FILE, O_RDONLY);
+  char got[RECORD];
+  for (long i = 0; i < n; i += 997) {
+    fill_record(rec, i);
+    assert(pread(fd, got, RECORD, i * RECORD) == RECORD);
+    assert(memcmp(got, rec, RECORD) == 0);
+  }
+  close(fd);
+  printf("append: %ld records, file size %zu\n", n, file_size(TEST_FILE));
+}
+
+void test_dirty_ranges() {
+  printf("\n=== Testing mapped_file dirty ranges ===\n");
+
+  struct mapped_file *mf = mapped_file_open(TEST_FILE, 0);
+  assert(mf != NULL);
+  size_t size = mf->size;
+  char buf[PAGE_SIZE * 2];
+  memset(buf, 'Z', sizeof(buf));
+
+  // 三个互不相邻的区间
+  assert(mapped_file_write(mf, PAGE_SIZE * 40, buf, 10) == 0);
+  assert(mapped_file_write(mf, PAGE_SIZE * 10, buf, 10) == 0);
+  assert(mapped_file_write(mf, PAGE_SIZE * 20, buf, 10) == 0);
+  assert(mf->nr_dirty == 3);
+  assert(mf->dirty[0].lo == PAGE_SIZE * 10 && mf->dirty[1].lo == PAGE_SIZE * 20 &&
+         mf->dirty[2].lo == PAGE_SIZE * 40);
+
+  // 跨页的写和相邻页合并: [10, 12) 和 [11, 21) 连起来
+  assert(mapped_file_write(mf, PAGE_SIZE * 11 - 1, buf, 2) == 0);
+  assert(mf->nr_dirty == 3 && mf->dirty[0].hi == PAGE_SIZE * 12);
+  for (size_t off = PAGE_SIZE * 12; off < PAGE_SIZE * 20; off += sizeof(buf))
+    assert(mapped_file_write(mf, off, buf, sizeof(buf)) == 0);
+  assert(mf->nr_dirty == 2);
+  assert(mf->dirty[0].lo == PAGE_SIZE * 10 && mf->dirty[0].hi == PAGE_SIZE * 21);
+
+  // 覆盖所有区间
+  assert(mapped_file_write(mf, 0, buf, 1) == 0);
+  assert(mapped_file_write(mf, PAGE_SIZE * 5, buf, 1) == 0);
+  assert(mf->nr_dirty == 4);
+  for (size_t off = 0; off < PAGE_SIZE * 45; off += sizeof(buf))
+    assert(mapped_file_write(mf, off, buf, sizeof(buf)) == 0);
+  assert(mf->nr_dirty == 1);
+  assert(mf->dirty[0].lo == 0 && mf->dirty[0].hi == PAGE_SIZE * 46);
+
+  assert(mapped_file_commit(mf) == 0 && mf->nr_dirty == 0);
+  assert(mapped_file_commit(mf) == 0 && mf->commits == 1);
+  assert(mapped_file_close(mf) == 0);
+
+  // 覆盖写不改变文件大小
+  assert(file_size(TEST_FILE) == size);
+  int fd = open(TEST_FILE, O_RDONLY);
+  char c;
+  assert(pread(fd, &c, 1, PAGE_SIZE * 30) == 1 && c == 'Z');
+  close(fd);
+}
+
+void test_vs_file_mmap_write() {
+  printf("\n=== Comparing with file_mmap_write ===\n");
+
+  const int n = 2000;
+  char rec[RECORD + 1];
+  struct timespec t0;
+
+  unlink(TEST_FILE);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < n; i++) {
+    fill_record(rec, i);
+    rec[RECORD] = '\0';
+    assert(file_mmap_write(TEST_FILE, (size_t)i * RECORD, rec) == 0);
+  }
+  double ms_old = elapsed_ms(&t0);
+  assert(file_size(TEST_FILE) == (size_t)n * RECORD);
+
+  unlink(TEST_FILE);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  struct mapped_file *mf = mapped_file_open(TEST_FILE, O_CREAT);
+  assert(mf != NULL);
+  for (int i = 0; i < n; i++) {
+    fill_record(rec, i);
+    assert(mapped_file_write(mf, (size_t)i * RECORD, rec, RECORD) == 0);
+    if (i % 500 == 499)
+      assert(mapped_file_commit(mf) == 0);
+  }
+  assert(mapped_file_close(mf) == 0);
+  double ms_new = elapsed_ms(&t0);
+  assert(file_size(TEST_FILE) == (size_t)n * RECORD);
+
+  printf("%d x %d-byte writes: file_mmap_write %.2f ms, mapped_file %.2f ms "
+         "(commit every 500)\n", n, RECORD, ms_old, ms_new);
+}
+
+int main() {
+  test_append_and_grow();
+  test_dirty_ranges();
+  test_vs_file_mmap_write();
+  unlink(TEST_FILE);
+  printf("\nAll mapped_file tests passed.\n");
+  return 0;
+}
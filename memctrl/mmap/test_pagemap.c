@@ -0,0 +1,158 @@
+#include "impl.c"
+#include "pagemap.h"
+#include <assert.h>
+#include <time.h>
+
+#define PAGE_SIZE 4096
+
+struct find {
+  uintptr_t start;
+  struct pagemap_summary s;
+  int found;
+};
+
+static int find_vma(const struct pagemap_vma *vma, const struct pagemap_summary *s, void *arg) {
+  struct find *f = arg;
+  if (vma->start <= f->start && f->start < vma->end) {
+    f->s = *s;
+    f->found = 1;
+  }
+  return 0;
+}
+
+// 和单页 pread 的结果对比
+static uint64_t single_entry(void *va) {
+  int fd = open("/proc/self/pagemap", O_RDONLY);
+  uint64_t e = 0;
+  assert(pread(fd, &e, sizeof(e), (uintptr_t)va / PAGE_SIZE * sizeof(e)) == sizeof(e));
+  close(fd);
+  return e;
+}
+
+void test_anon_range(struct pagemap_ctx *pm) {
+  printf("\n=== Testing anonymous range ===\n");
+
+  size_t npages = 256;
+  char *p = mmap(NULL, npages * PAGE_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(p != MAP_FAILED);
+  madvise(p, npages * PAGE_SIZE, MADV_NOHUGEPAGE);
+  // 只碰偶数页
+  for (size_t i = 0; i < npages; i += 2)
+    p[i * PAGE_SIZE] = 1;
+
+  struct pagemap_summary s = {0};
+  assert(pagemap_scan_range(pm, (uintptr_t)p, (uintptr_t)p + npages * PAGE_SIZE, &s) == 0);
+  assert(s.pages == npages);
+  assert(s.present == npages / 2);
+  assert(s.swapped == 0 && s.file == 0);
+  assert(s.exclusive == npages / 2);
+  if (pm->flags_ok) {
+    assert(s.anon == npages / 2);
+    assert(s.thp == 0 && s.hugetlb == 0);
+    uint64_t nodes = 0;
+    for (int n = 0; n < PAGEMAP_MAX_NODES; n++)
+      nodes += s.node_pages[n];
+    assert(nodes == s.present);
+  }
+
+  // 同一个 VMA 通过 maps 找到的结果一致
+  struct find f = {.start = (uintptr_t)p};
+  assert(pagemap_scan_vmas(pm, find_vma, &f) == 0 && f.found);
+  assert(f.s.present == s.present && f.s.pages == s.pages);
+
+  // 批量读出的表项和逐页 pread 相同
+  assert(pread(pm->pagemap_fd, pm->entries, 4 * sizeof(uint64_t),
+               (uintptr_t)p / PAGE_SIZE * sizeof(uint64_t)) == 4 * sizeof(uint64_t));
+  for (int i = 0; i < 4; i++)
+    assert(pm->entries[i] == single_entry(p + i * PAGE_SIZE));
+  munmap(p, npages * PAGE_SIZE);
+  printf("present %lu/%lu, anon %lu\n", (unsigned long)s.present,
+         (unsigned long)s.pages, (unsigned long)s.anon);
+}
+
+void test_thp_range(struct pagemap_ctx *pm) {
+  printf("\n=== Testing THP range ===\n");
+
+  size_t size = huge_page_size() * 2;
+  char *p = mmap_remap_ex(NULL, size, MMAP_REMAP_THP);
+  assert(p != NULL);
+  memset(p, 1, size);
+
+  struct pagemap_summary s = {0};
+  assert(pagemap_scan_range(pm, (uintptr_t)p, (uintptr_t)p + size, &s) == 0);
+  assert(s.present == size / PAGE_SIZE);
+  if (pm->flags_ok) {
+    // THP 可能被关掉或者分配不到，只在 kpageflags 说是 THP 时检查一致性
+    printf("thp %lu/%lu pages\n", (unsigned long)s.thp, (unsigned long)s.present);
+    assert(s.thp == 0 || s.anon == s.present);
+    assert(s.hugetlb == 0);
+  }
+  // THP 的 PFN 连续，kpageflags 应当只读很少几次
+  uint64_t reads = pm->kpf_reads;
+  memset(&s, 0, sizeof(s));
+  assert(pagemap_scan_range(pm, (uintptr_t)p, (uintptr_t)p + size, &s) == 0);
+  if (pm->flags_ok && s.thp == s.present)
+    assert(pm->kpf_reads - reads <= 2);
+  munmap(p, size);
+}
+
+void test_file_range(struct pagemap_ctx *pm) {
+  printf("\n=== Testing file-backed range ===\n");
+
+  const char *name = "pagemap_test.bin";
+  char buf[PAGE_SIZE * 8];
+  memset(buf, 'x', sizeof(buf));
+  int fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  assert(fd >= 0 && write(fd, buf, sizeof(buf)) == sizeof(buf));
+  char *p = mmap(NULL, sizeof(buf), PROT_READ, MAP_SHARED, fd, 0);
+  assert(p != MAP_FAILED);
+  volatile char c = 0;
+  for (size_t i = 0; i < sizeof(buf); i += PAGE_SIZE)
+    c += p[i];
+  (void)c;
+
+  struct pagemap_summary s = {0};
+  assert(pagemap_scan_range(pm, (uintptr_t)p, (uintptr_t)p + sizeof(buf), &s) == 0);
+  assert(s.present == 8 && s.file == 8);
+  if (pm->flags_ok)
+    assert(s.anon == 0);
+  munmap(p, sizeof(buf));
+  close(fd);
+  unlink(name);
+}
+
+void test_whole_process(struct pagemap_ctx *pm) {
+  printf("\n=== Scanning whole process ===\n");
+
+  // 1 GiB 预留 + 64 MiB 驻留
+  size_t size = 1UL << 30;
+  char *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  assert(p != MAP_FAILED);
+  memset(p, 1, 64UL << 20);
+
+  struct find f = {.start = (uintptr_t)p};
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  assert(pagemap_scan_vmas(pm, find_vma, &f) == 0 && f.found);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  assert(f.s.present >= (64UL << 20) / PAGE_SIZE);
+  printf("scanned in %.2f ms, %lu kpageflags reads so far\n",
+         (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6,
+         (unsigned long)pm->kpf_reads);
+  munmap(p, size);
+}
+
+int main() {
+  struct pagemap_ctx pm;
+  assert(pagemap_open(&pm, 0) == 0);
+  test_anon_range(&pm);
+  test_thp_range(&pm);
+  test_file_range(&pm);
+  test_whole_process(&pm);
+  printf("flags_ok=%d nr_nodes=%d\n", pm.flags_ok, pm.nr_nodes);
+  pagemap_close(&pm);
+  printf("\nAll pagemap tests passed.\n");
+  return 0;
+}
@@ -0,0 +1,374 @@
+#ifndef _KV_CLIENT_HPP
+#define _KV_CLIENT_HPP
+
+/*
+ * Header-only C++ client for the write_kv / read_kv syscalls.
+ *
+ *  - kv::Client 缓存写操作 (write coalescing)，同一个 key 的多次写只落一次
+ *    系统调用；缓冲区在 key 数量或最老写入的等待时间超过阈值时自动 flush
+ *  - kv::Client::Batch 是 RAII 批量写，析构时提交 (可 discard 放弃)
+ *  - put_as<T> / get_as<T> 提供类型化访问 (T 需能放进一个 int)
+ *  - Options::metrics 打开后记录每次调用的延迟直方图
+ *
+ * 一个 Client 只能被一个线程使用；多个线程请各自持有 Client
+ * (底层 KV store 仍是整个进程共享的)。
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <ostream>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "kv_syscalls.h"
+
+namespace kv {
+
+using clock = std::chrono::steady_clock;
+
+/**
+ * log2 分桶的延迟直方图，bucket i 统计 [2^i, 2^(i+1)) ns 的样本
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kBuckets = 64;
+
+    void record(uint64_t ns)
+    {
+        int b = ns ? 63 - __builtin_clzll(ns) : 0;
+        buckets_[b]++;
+        count_++;
+        sum_ += ns;
+        if (ns > max_)
+            max_ = ns;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    uint64_t mean() const { return count_ ? sum_ / count_ : 0; }
+
+    /**
+     * @brief 估算百分位数
+     * @param p 百分位 (0, 100]
+     * @return 该百分位所在 bucket 的上界 (ns)
+     */
+    uint64_t percentile(double p) const
+    {
+        if (!count_)
+            return 0;
+        uint64_t target = (uint64_t)(count_ * p / 100.0);
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; i++) {
+            seen += buckets_[i];
+            if (seen > target || seen == count_)
+                return i == 63 ? UINT64_MAX : (2ULL << i) - 1;
+        }
+        return max_;
+    }
+
+    void reset() { *this = LatencyHistogram(); }
+
+    void dump(std::ostream &os, const char *name) const
+    {
+        os << name << ": n=" << count_ << " mean=" << mean() << "ns"
+           << " p50<=" << percentile(50) << "ns"
+           << " p99<=" << percentile(99) << "ns"
+           << " max=" << max_ << "ns\n";
+    }
+
+private:
+    uint64_t buckets_[kBuckets] = {};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+struct Metrics {
+    LatencyHistogram read;      // get() 中真正进入内核的读
+    LatencyHistogram write;     // 每个 write_kv 系统调用
+    LatencyHistogram flush;     // 整次 flush
+    uint64_t puts = 0;          // put() 调用次数
+    uint64_t coalesced = 0;     // 被后续写覆盖、无需系统调用的写
+    uint64_t buffer_hits = 0;   // 直接从写缓冲命中的读
+    uint64_t syscalls = 0;      // 实际发出的系统调用数
+
+    void dump(std::ostream &os) const
+    {
+        os << "puts=" << puts << " coalesced=" << coalesced
+           << " buffer_hits=" << buffer_hits << " syscalls=" << syscalls << "\n";
+        read.dump(os, "read ");
+        write.dump(os, "write");
+        flush.dump(os, "flush");
+    }
+};
+
+struct Options {
+    size_t max_pending = 256;                       // 缓冲的 key 数达到该值时 flush
+    std::chrono::microseconds max_delay{1000};      // 最老的缓冲写等待超过该时间时 flush
+    bool metrics = false;                           // 是否记录延迟直方图
+};
+
+class Client {
+public:
+    class Batch;
+
+    explicit Client(Options opt = Options()) : opt_(opt) {}
+    ~Client() { flush(); }
+
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+
+    /**
+     * @brief 缓冲写入一个键值对
+     * @return 成功返回 0；触发的 flush 失败时返回 -1
+     */
+    int put(int k, int v)
+    {
+        if (opt_.metrics)
+            metrics_.puts++;
+        if (pending_.empty())
+            oldest_ = clock::now();
+        auto it = pending_.find(k);
+        if (it != pending_.end()) {
+            it->second = v;
+            if (opt_.metrics)
+                metrics_.coalesced++;
+        } else {
+            pending_.emplace(k, v);
+        }
+        return maybe_flush();
+    }
+
+    /**
+     * @brief 绕过缓冲直接写入；同 key 的缓冲写被丢弃 (反正会被这次写覆盖)，
+     *        不会先提交，之后 flush 也不会把旧值写回去
+     * @return 成功返回 0，失败返回 -1
+     */
+    int put_sync(int k, int v)
+    {
+        if (pending_.erase(k) && opt_.metrics)
+            metrics_.coalesced++;
+        return do_write(k, v);
+    }
+
+    /**
+     * @brief 读取一个 key，先查写缓冲再进内核
+     * @return key 不存在时返回 std::nullopt
+     * @note 内核用 -1 表示 "不存在"，因此存入的 -1 也会读成 nullopt
+     */
+    std::optional<int> get(int k)
+    {
+        auto it = pending_.find(k);
+        if (it != pending_.end()) {
+            if (opt_.metrics)
+                metrics_.buffer_hits++;
+            return it->second;
+        }
+
+        int v;
+        if (opt_.metrics) {
+            auto t0 = clock::now();
+            v = read_kv(k);
+            metrics_.read.record(elapsed_ns(t0));
+            metrics_.syscalls++;
+        } else {
+            v = read_kv(k);
+        }
+        if (v == -1)
+            return std::nullopt;
+        return v;
+    }
+
+    /**
+     * 类型化访问：T 按位存进 value (int)，要求 T 可平凡拷贝且不大于 int
+     */
+    template <typename T>
+    int put_as(int k, const T &v)
+    {
+        return put(k, to_raw(v));
+    }
+
+    template <typename T>
+    std::optional<T> get_as(int k)
+    {
+        auto raw = get(k);
+        if (!raw)
+            return std::nullopt;
+        return from_raw<T>(*raw);
+    }
+
+    /**
+     * @brief 把缓冲中的写全部提交到内核
+     * @return 全部成功返回 0，有失败返回 -1 (失败的写会被丢弃)
+     */
+    int flush()
+    {
+        if (pending_.empty())
+            return 0;
+
+        auto t0 = clock::now();
+        int ret = 0;
+        for (auto &kv : pending_) {
+            if (do_write(kv.first, kv.second) < 0)
+                ret = -1;
+        }
+        pending_.clear();
+        if (opt_.metrics)
+            metrics_.flush.record(elapsed_ns(t0));
+        return ret;
+    }
+
+    /**
+     * @brief 若最老的缓冲写已超时则 flush，适合在事件循环空闲时调用
+     */
+    int poll()
+    {
+        if (!pending_.empty() && clock::now() - oldest_ >= opt_.max_delay)
+            return flush();
+        return 0;
+    }
+
+    /**
+     * @brief 开启一个 RAII 批量写
+     */
+    Batch batch();
+
+    size_t pending() const { return pending_.size(); }
+    const Options &options() const { return opt_; }
+    const Metrics &metrics() const { return metrics_; }
+    void reset_metrics() { metrics_ = Metrics(); }
+
+private:
+    template <typename T>
+    static int to_raw(const T &v)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        static_assert(sizeof(T) <= sizeof(int), "T must fit in an int");
+        int raw = 0;
+        std::memcpy(&raw, &v, sizeof(T));
+        return raw;
+    }
+
+    template <typename T>
+    static T from_raw(int raw)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        static_assert(sizeof(T) <= sizeof(int), "T must fit in an int");
+        T v;
+        std::memcpy(&v, &raw, sizeof(T));
+        return v;
+    }
+
+    static uint64_t elapsed_ns(clock::time_point t0)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count();
+    }
+
+    int do_write(int k, int v)
+    {
+        int ret;
+        if (opt_.metrics) {
+            auto t0 = clock::now();
+            ret = write_kv(k, v);
+            metrics_.write.record(elapsed_ns(t0));
+            metrics_.syscalls++;
+        } else {
+            ret = write_kv(k, v);
+        }
+        return ret < 0 ? -1 : 0;
+    }
+
+    int maybe_flush()
+    {
+        if (batch_depth_ > 0)
+            return 0;
+        if (pending_.size() >= opt_.max_pending ||
+            clock::now() - oldest_ >= opt_.max_delay)
+            return flush();
+        return 0;
+    }
+
+    Options opt_;
+    Metrics metrics_;
+    std::unordered_map<int, int> pending_;
+    clock::time_point oldest_;
+    int batch_depth_ = 0;       // 活跃 Batch 的数量，期间暂停自动 flush
+};
+
+/**
+ * RAII 批量写：写入先暂存在 Batch 中，commit() 或析构时一次性合入
+ * Client 并 flush；discard() 放弃所有暂存的写。Batch 存活期间 Client
+ * 不会因为大小/时间阈值自动 flush。
+ */
+class Client::Batch {
+public:
+    explicit Batch(Client &c) : client_(&c) { client_->batch_depth_++; }
+
+    Batch(Batch &&o) noexcept : client_(o.client_), writes_(std::move(o.writes_))
+    {
+        o.client_ = nullptr;
+    }
+
+    Batch(const Batch &) = delete;
+    Batch &operator=(const Batch &) = delete;
+    Batch &operator=(Batch &&) = delete;
+
+    ~Batch() { commit(); }
+
+    void put(int k, int v) { writes_[k] = v; }
+
+    template <typename T>
+    void put_as(int k, const T &v) { put(k, Client::to_raw(v)); }
+
+    /**
+     * @brief 提交暂存的写
+     * @return 成功返回 0，失败返回 -1
+     */
+    int commit()
+    {
+        if (!client_)
+            return 0;
+        Client *c = client_;
+        release();
+        if (c->opt_.metrics)
+            c->metrics_.puts += writes_.size();
+        if (c->pending_.empty() && !writes_.empty())
+            c->oldest_ = clock::now();
+        for (auto &kv : writes_)
+            c->pending_[kv.first] = kv.second;
+        writes_.clear();
+        return c->batch_depth_ > 0 ? 0 : c->flush();
+    }
+
+    void discard()
+    {
+        writes_.clear();
+        release();
+    }
+
+    size_t size() const { return writes_.size(); }
+
+private:
+    void release()
+    {
+        if (client_) {
+            client_->batch_depth_--;
+            client_ = nullptr;
+        }
+    }
+
+    Client *client_;
+    std::unordered_map<int, int> writes_;
+};
+
+inline Client::Batch Client::batch()
+{
+    return Batch(*this);
+}
+
+} // namespace kv
+
+#endif // _KV_CLIENT_HPP
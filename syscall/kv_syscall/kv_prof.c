@@ -0,0 +1,98 @@
+/*
+ * 用内核的 sysprof 分析 write_kv / read_kv 的开销
+ *
+ * 用法: sudo ./kv_prof [-t threads] [-n ops] [-k keys] [-e sample_every] [-s nr]
+ *
+ * 打开 /sys/kernel/debug/sysprof/enable，多线程跑一段 KV 读写，关掉后打印
+ * hist。keys 越小锁竞争越重，lock 一栏会明显变大。
+ * -s 给出 configure_socket_fairness 的系统调用号时也一并调用它 (内核打了
+ * network/socket/socket.patch 才有)。
+ */
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "kv_syscalls.h"
+
+#define SYSPROF_DIR "/sys/kernel/debug/sysprof/"
+
+static long ops = 100000;
+static int keys = 1024;
+static long socket_nr = -1;
+
+static int write_file(const char *name, const char *val)
+{
+    int fd = open(name, O_WRONLY);
+    if (fd < 0 || write(fd, val, strlen(val)) < 0) {
+        perror(name);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+static void *worker(void *arg)
+{
+    unsigned int seed = (unsigned int)(long)arg;
+
+    for (long i = 0; i < ops; i++) {
+        int k = rand_r(&seed) % keys;
+        if (i & 1)
+            read_kv(k);
+        else
+            write_kv(k, (int)i);
+        if (socket_nr >= 0 && i % 64 == 0)
+            syscall(socket_nr, syscall(SYS_gettid), 1000);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = 4, opt;
+    const char *every = "1";
+
+    while ((opt = getopt(argc, argv, "t:n:k:e:s:")) != -1) {
+        switch (opt) {
+        case 't': threads = atoi(optarg); break;
+        case 'n': ops = atol(optarg); break;
+        case 'k': keys = atoi(optarg); break;
+        case 'e': every = optarg; break;
+        case 's': socket_nr = atol(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-t threads] [-n ops] [-k keys] [-e sample_every] [-s nr]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1 || keys < 1)
+        return 1;
+
+    if (write_file(SYSPROF_DIR "sample_every", every) ||
+        write_file(SYSPROF_DIR "reset", "1") ||
+        write_file(SYSPROF_DIR "enable", "1"))
+        return 1;
+
+    pthread_t tids[threads];
+    for (long i = 0; i < threads; i++)
+        pthread_create(&tids[i], NULL, worker, (void *)(i + 1));
+    for (int i = 0; i < threads; i++)
+        pthread_join(tids[i], NULL);
+
+    write_file(SYSPROF_DIR "enable", "0");
+
+    FILE *f = fopen(SYSPROF_DIR "hist", "r");
+    if (!f) {
+        perror(SYSPROF_DIR "hist");
+        return 1;
+    }
+    char line[1024];
+    printf("threads=%d ops=%ld keys=%d sample_every=%s\n", threads, ops, keys, every);
+    while (fgets(line, sizeof(line), f))
+        fputs(line, stdout);
+    fclose(f);
+    return 0;
+}
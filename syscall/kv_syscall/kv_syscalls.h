@@ -12,6 +12,43 @@
 #define __NR_read_kv 450
 #endif
 
+#ifndef __NR_write_kv2
+#define __NR_write_kv2 451
+#endif
+
+#ifndef __NR_read_kv2
+#define __NR_read_kv2 452
+#endif
+
+#ifndef __NR_kv_dump
+#define __NR_kv_dump 453
+#endif
+
+#ifndef __NR_kv_load
+#define __NR_kv_load 454
+#endif
+
+/* flags for write_kv_flags / read_kv_flags / kv_dump / kv_load */
+#ifndef KV_PRIVATE
+#define KV_PRIVATE 0x1  /* calling thread's private store, no locking in kernel */
+#endif
+
+/* kv_dump 文件格式: 一个 header, 之后是若干 {key, value} 直到 EOF */
+#ifndef KV_DUMP_MAGIC
+#define KV_DUMP_MAGIC 0x3153564b  /* "KVS1" */
+#define KV_DUMP_VERSION 1
+
+struct kv_dump_header {
+    unsigned int magic;
+    unsigned int version;
+};
+
+struct kv_dump_record {
+    int key;
+    int value;
+};
+#endif
+
 /**
  * write a key-value pair
  * @param k key
@@ -33,4 +70,49 @@ static inline int read_kv(int k)
     return syscall(__NR_read_kv, k);
 }
 
+/**
+ * write a key-value pair with flags
+ * @param k key
+ * @param v value
+ * @param flags 0 or KV_PRIVATE
+ * @return success return the number of bytes written, fail return -1
+ */
+static inline int write_kv_flags(int k, int v, unsigned int flags)
+{
+    return syscall(__NR_write_kv2, k, v, flags);
+}
+
+/**
+ * read a value by key with flags
+ * @param k key
+ * @param flags 0 or KV_PRIVATE
+ * @return success return the value, fail return -1
+ */
+static inline int read_kv_flags(int k, unsigned int flags)
+{
+    return syscall(__NR_read_kv2, k, flags);
+}
+
+/**
+ * dump the whole store to a file, starting at the current file offset
+ * @param fd file opened for writing
+ * @param flags 0 or KV_PRIVATE
+ * @return success return the number of records written, fail return -1
+ */
+static inline int kv_dump(int fd, unsigned int flags)
+{
+    return syscall(__NR_kv_dump, fd, flags);
+}
+
+/**
+ * load records written by kv_dump into the store (existing keys are overwritten)
+ * @param fd file opened for reading
+ * @param flags 0 or KV_PRIVATE
+ * @return success return the number of records loaded, fail return -1
+ */
+static inline int kv_load(int fd, unsigned int flags)
+{
+    return syscall(__NR_kv_load, fd, flags);
+}
+
 #endif // _KV_SYSCALLS_H
\ No newline at end of file
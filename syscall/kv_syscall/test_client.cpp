@@ -0,0 +1,144 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include "kv_client.hpp"
+
+enum class Color : unsigned char { Red, Green, Blue };
+
+int main()
+{
+    printf("Testing kv::Client...\n");
+
+    // Test 1: 写缓冲 + 读自己的写
+    {
+        kv::Options opt;
+        opt.max_pending = 1024;
+        opt.max_delay = std::chrono::seconds(10);
+        opt.metrics = true;
+        kv::Client c(opt);
+
+        for (int i = 0; i < 100; i++)
+            assert(c.put(7000, i) == 0);
+        assert(c.pending() == 1);
+        assert(c.get(7000) == 99);
+        assert(c.metrics().coalesced == 99);
+        assert(c.metrics().syscalls == 0);
+
+        assert(c.flush() == 0);
+        assert(c.pending() == 0);
+        assert(c.metrics().syscalls == 1);
+        assert(read_kv(7000) == 99);
+    }
+    printf("Test 1 passed: write coalescing\n");
+
+    // Test 2: 按大小 flush
+    {
+        kv::Options opt;
+        opt.max_pending = 16;
+        opt.max_delay = std::chrono::seconds(10);
+        kv::Client c(opt);
+
+        for (int i = 0; i < 15; i++)
+            c.put(7100 + i, i);
+        assert(c.pending() == 15);
+        c.put(7115, 15);
+        assert(c.pending() == 0);
+        for (int i = 0; i < 16; i++)
+            assert(read_kv(7100 + i) == i);
+    }
+    printf("Test 2 passed: flush on size\n");
+
+    // Test 3: 按时间 flush
+    {
+        kv::Options opt;
+        opt.max_pending = 1024;
+        opt.max_delay = std::chrono::milliseconds(5);
+        kv::Client c(opt);
+
+        c.put(7200, 1);
+        assert(c.pending() == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        assert(c.poll() == 0);
+        assert(c.pending() == 0);
+        assert(read_kv(7200) == 1);
+    }
+    printf("Test 3 passed: flush on time\n");
+
+    // Test 4: RAII batch
+    {
+        kv::Client c;
+        {
+            auto b = c.batch();
+            for (int i = 0; i < 50; i++)
+                b.put(7300 + i, i * 3);
+        }
+        for (int i = 0; i < 50; i++)
+            assert(read_kv(7300 + i) == i * 3);
+
+        write_kv(7400, 1);
+        {
+            auto b = c.batch();
+            b.put(7400, 2);
+            b.discard();
+        }
+        c.flush();
+        assert(read_kv(7400) == 1);
+    }
+    printf("Test 4 passed: RAII batch commit/discard\n");
+
+    // Test 5: 类型化访问
+    {
+        kv::Client c;
+        c.put_as<float>(7500, 3.5f);
+        c.put_as<Color>(7501, Color::Blue);
+        c.put_as<bool>(7502, true);
+        c.flush();
+        assert(c.get_as<float>(7500) == 3.5f);
+        assert(c.get_as<Color>(7501) == Color::Blue);
+        assert(c.get_as<bool>(7502) == true);
+        assert(!c.get_as<float>(7599).has_value());
+    }
+    printf("Test 5 passed: typed accessors\n");
+
+    // Test 6: 延迟直方图
+    {
+        kv::Options opt;
+        opt.metrics = true;
+        kv::Client c(opt);
+        for (int i = 0; i < 1000; i++) {
+            c.put_sync(7600, i);
+            c.get(7600);
+        }
+        assert(c.metrics().write.count() == 1000);
+        assert(c.metrics().read.count() == 1000);
+        assert(c.metrics().read.percentile(50) <= c.metrics().read.percentile(99));
+        c.metrics().dump(std::cout);
+    }
+    printf("Test 6 passed: latency histograms\n");
+
+    // Test 7: put 之后同 key 的 put_sync 丢弃缓冲写，flush 不会写回旧值
+    {
+        kv::Options opt;
+        opt.max_pending = 1024;
+        opt.max_delay = std::chrono::seconds(10);
+        opt.metrics = true;
+        kv::Client c(opt);
+
+        c.put(7700, 1);
+        c.put(7701, 2);
+        assert(c.put_sync(7700, 3) == 0);
+        assert(c.pending() == 1);
+        assert(c.metrics().syscalls == 1);
+        assert(c.metrics().coalesced == 1);
+        assert(read_kv(7700) == 3);
+        assert(c.get(7700) == 3);
+        assert(c.flush() == 0);
+        assert(read_kv(7700) == 3);
+        assert(read_kv(7701) == 2);
+    }
+    printf("Test 7 passed: put followed by put_sync\n");
+
+    printf("All client tests PASSED!\n");
+    return 0;
+}
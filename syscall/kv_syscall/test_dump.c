@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <sys/wait.h>
+#include "kv_syscalls.h"
+
+#define NUM_KEYS 10000
+#define DUMP_FILE "kv_dump.bin"
+
+int main()
+{
+    int fd, i, ret, status;
+    pid_t pid;
+
+    printf("Testing kv_dump/kv_load...\n");
+
+    // 同一个 bucket 中放大量 key，检验 dump 缓冲区扩容
+    for (i = 0; i < NUM_KEYS; i++)
+        assert(write_kv(i * 1024, i) == sizeof(int));
+
+    // Test 1: dump
+    fd = open(DUMP_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    ret = kv_dump(fd, 0);
+    assert(ret >= NUM_KEYS);
+    assert(lseek(fd, 0, SEEK_CUR) ==
+           (off_t)(sizeof(struct kv_dump_header) + ret * sizeof(struct kv_dump_record)));
+
+    struct kv_dump_header hdr;
+    assert(pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr));
+    assert(hdr.magic == KV_DUMP_MAGIC && hdr.version == KV_DUMP_VERSION);
+    close(fd);
+    printf("Test 1 passed: dumped %d records\n", ret);
+
+    // Test 2: 新进程 (空 store) 中 load
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        // fork 出的进程有自己的空 store
+        assert(read_kv(1024) == -1);
+        fd = open(DUMP_FILE, O_RDONLY);
+        assert(fd >= 0);
+        assert(kv_load(fd, 0) == ret);
+        close(fd);
+        for (i = 0; i < NUM_KEYS; i++)
+            assert(read_kv(i * 1024) == i);
+        exit(0);
+    }
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    printf("Test 2 passed: load into a fresh process\n");
+
+    // Test 3: 私有空间
+    fd = open(DUMP_FILE, O_RDONLY);
+    assert(kv_load(fd, KV_PRIVATE) == ret);
+    close(fd);
+    assert(read_kv_flags(1024 * 5, KV_PRIVATE) == 5);
+    printf("Test 3 passed: load into the private store\n");
+
+    // Test 4: 截断/损坏的文件
+    fd = open(DUMP_FILE, O_RDWR);
+    assert(ftruncate(fd, sizeof(struct kv_dump_header) + 3) == 0);
+    assert(kv_load(fd, 0) == -1);
+    hdr.magic = 0;
+    assert(pwrite(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr));
+    lseek(fd, 0, SEEK_SET);
+    assert(kv_load(fd, 0) == -1);
+    close(fd);
+    printf("Test 4 passed: corrupt files rejected\n");
+
+    unlink(DUMP_FILE);
+    printf("All dump/load tests PASSED!\n");
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <assert.h>
+#include "kv_syscalls.h"
+
+#define NUM_THREADS 16
+#define NUM_KEYS 2048
+
+pthread_barrier_t barrier;
+
+void *thread_func(void *arg)
+{
+    int id = *(int *)arg;
+    int i;
+
+    pthread_barrier_wait(&barrier);
+
+    // 所有线程写同样的 key，私有空间互不可见
+    for (i = 0; i < NUM_KEYS; i++)
+        assert(write_kv_flags(i, id * NUM_KEYS + i, KV_PRIVATE) == sizeof(int));
+
+    pthread_barrier_wait(&barrier);
+
+    for (i = 0; i < NUM_KEYS; i++)
+        assert(read_kv_flags(i, KV_PRIVATE) == id * NUM_KEYS + i);
+
+    // 共享空间不受私有写影响
+    assert(read_kv(1) == 100);
+    return NULL;
+}
+
+int main()
+{
+    pthread_t threads[NUM_THREADS];
+    int ids[NUM_THREADS];
+    int i;
+
+    printf("Testing thread-private KV store...\n");
+
+    assert(write_kv(1, 100) == sizeof(int));
+    assert(read_kv_flags(1, 0) == 100);
+
+    // Test 1: 主线程的私有空间初始为空
+    assert(read_kv_flags(1, KV_PRIVATE) == -1);
+    assert(write_kv_flags(1, 7, KV_PRIVATE) == sizeof(int));
+    assert(read_kv_flags(1, KV_PRIVATE) == 7);
+    assert(read_kv(1) == 100);
+    printf("Test 1 passed: private store is separate from shared store\n");
+
+    // Test 2: 非法 flag
+    assert(write_kv_flags(1, 7, 0x80) == -1);
+    assert(read_kv_flags(1, 0x80) == -1);
+    printf("Test 2 passed: invalid flags rejected\n");
+
+    // Test 3: 多线程各自的私有空间
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    for (i = 0; i < NUM_THREADS; i++) {
+        ids[i] = i + 1;
+        pthread_create(&threads[i], NULL, thread_func, &ids[i]);
+    }
+    for (i = 0; i < NUM_THREADS; i++)
+        pthread_join(threads[i], NULL);
+    pthread_barrier_destroy(&barrier);
+
+    // 子线程的写不会出现在主线程的私有空间
+    assert(read_kv_flags(1, KV_PRIVATE) == 7);
+    assert(read_kv_flags(2, KV_PRIVATE) == -1);
+    printf("Test 3 passed: %d threads with private stores\n", NUM_THREADS);
+
+    printf("All private store tests PASSED!\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * multicall 与逐个系统调用的对比
+ *
+ * 用法: ./bench_multicall [-n iterations]
+ *
+ * 模拟一个请求处理函数的系统调用序列 (KV 读写 + xattr 读取 + getpid)，
+ * 分别用 N 次系统调用和一次 multicall 执行，长度取 5/10/20。
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/xattr.h>
+#include <time.h>
+#include <unistd.h>
+#include "multicall.h"
+#include "../kv_syscall/kv_syscalls.h"
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int fd;
+static char buf[64];
+
+// 第 i 个调用: 以 4 个为一组循环 read_kv, write_kv, fgetxattr, getpid
+static void prep(struct multicall_entry *e, int i)
+{
+    switch (i % 4) {
+    case 0: multicall_prep(e, __NR_read_kv, 40000 + i, 0, 0, 0, 0); break;
+    case 1: multicall_prep(e, __NR_write_kv, 40000 + i, i, 0, 0, 0); break;
+    case 2: multicall_prep(e, __NR_fgetxattr, fd, (uintptr_t)"user.bench", (uintptr_t)buf, sizeof(buf), 0); break;
+    case 3: multicall_prep(e, __NR_getpid, 0, 0, 0, 0, 0); break;
+    }
+}
+
+static void direct(int i)
+{
+    switch (i % 4) {
+    case 0: read_kv(40000 + i); break;
+    case 1: write_kv(40000 + i, i); break;
+    case 2: fgetxattr(fd, "user.bench", buf, sizeof(buf)); break;
+    case 3: syscall(__NR_getpid); break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long iters = 200000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n')
+            iters = atol(optarg);
+        else {
+            fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    char path[] = "/tmp/bench-multicall-XXXXXX";
+    fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    fsetxattr(fd, "user.bench", "value", 5, 0);
+
+    static const int lens[] = { 5, 10, 20 };
+    struct multicall_entry vec[MULTICALL_MAX];
+
+    printf("%-6s %14s %14s %8s\n", "calls", "direct ns/seq", "multicall ns", "speedup");
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        int n = lens[l];
+        double t0, direct_ns, multi_ns;
+
+        t0 = now_ns();
+        for (long it = 0; it < iters; it++)
+            for (int i = 0; i < n; i++)
+                direct(i);
+        direct_ns = (now_ns() - t0) / iters;
+
+        for (int i = 0; i < n; i++)
+            prep(&vec[i], i);
+        if (multicall(vec, n, 0) != n) {
+            perror("multicall");
+            break;
+        }
+        t0 = now_ns();
+        for (long it = 0; it < iters; it++)
+            multicall(vec, n, 0);
+        multi_ns = (now_ns() - t0) / iters;
+
+        printf("%-6d %14.1f %14.1f %7.2fx\n", n, direct_ns, multi_ns, direct_ns / multi_ns);
+    }
+
+    close(fd);
+    unlink(path);
+    return 0;
+}
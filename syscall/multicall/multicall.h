@@ -0,0 +1,56 @@
+#ifndef _MULTICALL_H
+#define _MULTICALL_H
+
+/*
+ * multicall: 一次进入内核执行一组系统调用
+ * 与内核 include/uapi/linux/multicall.h 保持一致
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef __NR_multicall
+#define __NR_multicall 458
+#endif
+
+#ifndef MULTICALL_MAX
+#define MULTICALL_MAX 64
+#define MULTICALL_STOP_ON_ERROR 0x1
+
+struct multicall_entry {
+    uint32_t nr;            /* 系统调用号 (白名单内) */
+    uint32_t flags;         /* 必须为 0 */
+    uint64_t args[6];
+    int64_t result;         /* 内核填写的返回值, 失败为 -errno */
+};
+#endif
+
+/**
+ * @brief 填写一个 multicall 项
+ */
+static inline void multicall_prep(struct multicall_entry *e, uint32_t nr,
+                                  uint64_t a0, uint64_t a1, uint64_t a2,
+                                  uint64_t a3, uint64_t a4)
+{
+    memset(e, 0, sizeof(*e));
+    e->nr = nr;
+    e->args[0] = a0;
+    e->args[1] = a1;
+    e->args[2] = a2;
+    e->args[3] = a3;
+    e->args[4] = a4;
+}
+
+/**
+ * @brief 执行 vec[0..n)
+ * @param flags 0 或 MULTICALL_STOP_ON_ERROR
+ * @return 执行了的项数，失败返回 -1 并设置 errno
+ */
+static inline int multicall(struct multicall_entry *vec, int n, unsigned int flags)
+{
+    return syscall(__NR_multicall, vec, n, flags);
+}
+
+#endif // _MULTICALL_H
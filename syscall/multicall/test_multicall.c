@@ -0,0 +1,86 @@
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+#include "multicall.h"
+#include "../kv_syscall/kv_syscalls.h"
+
+int main(void)
+{
+    struct multicall_entry vec[MULTICALL_MAX];
+    int n;
+
+    printf("Testing multicall...\n");
+
+    // Test 1: KV 读写混合，结果按项返回
+    for (int i = 0; i < 10; i++)
+        multicall_prep(&vec[i], __NR_write_kv, 30000 + i, i * 11, 0, 0, 0);
+    for (int i = 0; i < 10; i++)
+        multicall_prep(&vec[10 + i], __NR_read_kv, 30000 + i, 0, 0, 0, 0);
+    n = multicall(vec, 20, 0);
+    assert(n == 20);
+    for (int i = 0; i < 10; i++) {
+        assert(vec[i].result == sizeof(int));
+        assert(vec[10 + i].result == i * 11);
+    }
+    printf("Test 1 passed: %d KV calls in one entry\n", n);
+
+    // Test 2: 白名单之外的调用和非法 flags
+    multicall_prep(&vec[0], __NR_getpid, 0, 0, 0, 0, 0);
+    multicall_prep(&vec[1], __NR_unlink, (uintptr_t)"/tmp/multicall-never", 0, 0, 0, 0);
+    multicall_prep(&vec[2], __NR_multicall, 0, 0, 0, 0, 0);
+    multicall_prep(&vec[3], __NR_gettid, 0, 0, 0, 0, 0);
+    vec[3].flags = 1;
+    assert(multicall(vec, 4, 0) == 4);
+    assert(vec[0].result == getpid());
+    assert(vec[1].result == -EINVAL);
+    assert(vec[2].result == -EINVAL);
+    assert(vec[3].result == -EINVAL);
+    assert(multicall(vec, MULTICALL_MAX + 1, 0) == -1 && errno == EINVAL);
+    assert(multicall(vec, 1, 0x100) == -1 && errno == EINVAL);
+    printf("Test 2 passed: whitelist enforced\n");
+
+    // Test 3: stop-on-error
+    multicall_prep(&vec[0], __NR_write_kv, 30100, 1, 0, 0, 0);
+    multicall_prep(&vec[1], __NR_fgetxattr, -1, (uintptr_t)"user.x", 0, 0, 0);
+    multicall_prep(&vec[2], __NR_write_kv, 30101, 1, 0, 0, 0);
+    vec[2].result = 12345;
+    assert(multicall(vec, 3, MULTICALL_STOP_ON_ERROR) == 2);
+    assert(vec[1].result == -EBADF);
+    assert(vec[2].result == 12345);         // 没有执行
+    assert(read_kv(30101) == -1);
+    assert(multicall(vec, 3, 0) == 3);      // 不加 flag 时继续执行
+    assert(read_kv(30101) == 1);
+    printf("Test 3 passed: stop on error\n");
+
+    // Test 4: xattr 读取
+    {
+        char path[] = "/tmp/multicall-XXXXXX";
+        char buf[32];
+        int fd = mkstemp(path);
+        assert(fd >= 0);
+        if (fsetxattr(fd, "user.mc", "hello", 5, 0) == 0) {
+            multicall_prep(&vec[0], __NR_fgetxattr, fd, (uintptr_t)"user.mc", (uintptr_t)buf, sizeof(buf), 0);
+            multicall_prep(&vec[1], __NR_getxattr, (uintptr_t)path, (uintptr_t)"user.mc", (uintptr_t)buf, sizeof(buf), 0);
+            assert(multicall(vec, 2, 0) == 2);
+            assert(vec[0].result == 5 && vec[1].result == 5);
+            assert(memcmp(buf, "hello", 5) == 0);
+            printf("Test 4 passed: xattr reads\n");
+        } else {
+            printf("Test 4 skipped: user xattrs not supported on /tmp\n");
+        }
+        close(fd);
+        unlink(path);
+    }
+
+    // Test 5: vec 不可访问
+    assert(multicall((struct multicall_entry *)8, 1, 0) == -1 && errno == EFAULT);
+    printf("Test 5 passed: bad vector pointer\n");
+
+    printf("All multicall tests PASSED!\n");
+    return 0;
+}
@@ -0,0 +1,477 @@
+/*
+ * 进程/线程创建基准: 衡量 copy_process 里的 init_task_kv_store 和 exec 时
+ * 多装的 [vtask] 映射带来的开销
+ *
+ * 用法: ./bench_spawn [-n ops] [-k idle_procs] [-t tests] [-l label] > result.json
+ *
+ * tests 是逗号分隔的列表，默认全部:
+ *   fork    fork + 子进程 _exit + waitpid
+ *   vfork   vfork + 子进程 _exit + waitpid
+ *   thread  clone(CLONE_VM|CLONE_THREAD|...) + 等待 CLONE_CHILD_CLEARTID
+ *   spawn   posix_spawn 自己 (--child 立即退出) + waitpid
+ *   exec    一条 execve 链，每一环测从上一次 execve 到新映像 main 的时间
+ *
+ * 每项给出吞吐 (ops/s) 和单次延迟的百分位数。之后分别 fork 和
+ * fork+exec 出 idle_procs 个常驻子进程，用 /proc/meminfo 的差值算出
+ * 每个进程的 Slab/KernelStack/PageTables 增长，并给出子进程平均 VmRSS。
+ *
+ * 功能的开关靠换内核: [vtask] 可以用启动参数 vdso=0 关掉 (连同 vDSO
+ * 一起)，KV store 只能和原版内核对比。用 -l 给每次运行打标签，输出里
+ * 的 features 字段记录了实际检测到的功能。
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "../kv_syscall/kv_syscalls.h"
+
+extern char **environ;
+
+#define STACK_SIZE (64 * 1024)
+
+static char self_path[4096];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(const uint64_t *sorted, long n, double p)
+{
+    long i = (long)(p / 100.0 * (n - 1) + 0.5);
+    return sorted[i];
+}
+
+static int first_result = 1;
+
+static void report(const char *name, uint64_t *lat, long n, uint64_t elapsed_ns)
+{
+    uint64_t sum = 0;
+
+    qsort(lat, n, sizeof(*lat), cmp_u64);
+    for (long i = 0; i < n; i++)
+        sum += lat[i];
+    printf("%s    {\"name\": \"%s\", \"ops\": %ld, \"ops_per_sec\": %.1f, "
+           "\"mean_ns\": %.1f, \"min_ns\": %llu, \"p50_ns\": %llu, \"p90_ns\": %llu, "
+           "\"p99_ns\": %llu, \"max_ns\": %llu}",
+           first_result ? "" : ",\n", name, n, n * 1e9 / elapsed_ns, (double)sum / n,
+           (unsigned long long)lat[0],
+           (unsigned long long)percentile(lat, n, 50),
+           (unsigned long long)percentile(lat, n, 90),
+           (unsigned long long)percentile(lat, n, 99),
+           (unsigned long long)lat[n - 1]);
+    first_result = 0;
+    fflush(stdout);
+}
+
+static void reap(pid_t pid)
+{
+    int status;
+
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+}
+
+static int bench_fork(uint64_t *lat, long n)
+{
+    for (long i = 0; i < n; i++) {
+        uint64_t t0 = now_ns();
+        pid_t pid = fork();
+        if (pid < 0)
+            return -1;
+        if (pid == 0)
+            _exit(0);
+        reap(pid);
+        lat[i] = now_ns() - t0;
+    }
+    return 0;
+}
+
+// 单独一个函数，vfork 返回两次时不会弄坏调用者循环里的局部变量
+static __attribute__((noinline)) pid_t vfork_exit(void)
+{
+    pid_t pid = vfork();
+
+    if (pid == 0)
+        _exit(0);
+    return pid;
+}
+
+static int bench_vfork(uint64_t *lat, long n)
+{
+    for (long i = 0; i < n; i++) {
+        uint64_t t0 = now_ns();
+        pid_t pid = vfork_exit();
+        if (pid < 0)
+            return -1;
+        reap(pid);
+        lat[i] = now_ns() - t0;
+    }
+    return 0;
+}
+
+static int thread_fn(void *arg)
+{
+    (void)arg;
+    return 0;       // clone 的包装函数随后调用 exit，只结束这个线程
+}
+
+static int bench_thread(uint64_t *lat, long n)
+{
+    const int flags = CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND |
+                      CLONE_THREAD | CLONE_SYSVSEM | CLONE_CHILD_CLEARTID;
+    char *stack = mmap(NULL, STACK_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    volatile pid_t ctid;
+
+    if (stack == MAP_FAILED)
+        return -1;
+    for (long i = 0; i < n; i++) {
+        uint64_t t0 = now_ns();
+        pid_t tid;
+
+        ctid = 1;
+        tid = clone(thread_fn, stack + STACK_SIZE, flags, NULL, NULL, NULL, &ctid);
+        if (tid < 0) {
+            munmap(stack, STACK_SIZE);
+            return -1;
+        }
+        // 线程退出时内核把 ctid 清零并 futex_wake
+        while (ctid != 0)
+            syscall(SYS_futex, &ctid, FUTEX_WAIT, 1, NULL, NULL, 0);
+        lat[i] = now_ns() - t0;
+    }
+    munmap(stack, STACK_SIZE);
+    return 0;
+}
+
+static int bench_spawn(uint64_t *lat, long n)
+{
+    char *argv[] = { self_path, "--child", NULL };
+
+    for (long i = 0; i < n; i++) {
+        uint64_t t0 = now_ns();
+        pid_t pid;
+
+        if (posix_spawn(&pid, self_path, NULL, NULL, argv, environ) != 0)
+            return -1;
+        reap(pid);
+        lat[i] = now_ns() - t0;
+    }
+    return 0;
+}
+
+/*
+ * execve 链的一环: 记下从上一环 execve 到这里的时间写进管道，
+ * 还有剩余就继续 exec 自己
+ */
+static int exec_chain(int fd, long left, uint64_t t0)
+{
+    uint64_t dt = now_ns() - t0;
+    char sfd[16], sleft[32], st0[32];
+
+    if (write(fd, &dt, sizeof(dt)) != sizeof(dt))
+        return 1;
+    if (--left <= 0)
+        return 0;
+
+    snprintf(sfd, sizeof(sfd), "%d", fd);
+    snprintf(sleft, sizeof(sleft), "%ld", left);
+    char *argv[] = { self_path, "--exec-chain", sfd, sleft, st0, NULL };
+    snprintf(st0, sizeof(st0), "%llu", (unsigned long long)now_ns());
+    execve(self_path, argv, environ);
+    return 1;
+}
+
+static int bench_exec(uint64_t *lat, long n)
+{
+    int p[2];
+    long got = 0;
+    pid_t pid;
+
+    if (pipe(p) != 0)
+        return -1;
+    pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        close(p[0]);
+        _exit(exec_chain(p[1], n + 1, now_ns()));
+    }
+    close(p[1]);
+    // 第一环是 fork 出来的子进程本身，不算 exec
+    uint64_t first;
+    if (read(p[0], &first, sizeof(first)) != sizeof(first)) {
+        close(p[0]);
+        reap(pid);
+        return -1;
+    }
+    while (got < n) {
+        ssize_t r = read(p[0], &lat[got], sizeof(*lat));
+        if (r != sizeof(*lat))
+            break;
+        got++;
+    }
+    close(p[0]);
+    reap(pid);
+    return got == n ? 0 : -1;
+}
+
+/* ---------- 每个进程的内存开销 ---------- */
+
+static const char *meminfo_keys[] = { "Slab", "SUnreclaim", "KernelStack", "PageTables" };
+#define NR_MEMINFO (sizeof(meminfo_keys) / sizeof(meminfo_keys[0]))
+
+static int read_meminfo(long kb[NR_MEMINFO])
+{
+    FILE *f = fopen("/proc/meminfo", "r");
+    char line[256];
+
+    if (!f)
+        return -1;
+    while (fgets(line, sizeof(line), f)) {
+        for (size_t i = 0; i < NR_MEMINFO; i++) {
+            size_t len = strlen(meminfo_keys[i]);
+            if (strncmp(line, meminfo_keys[i], len) == 0 && line[len] == ':')
+                kb[i] = atol(line + len + 1);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static long proc_rss_kb(pid_t pid)
+{
+    char path[64], line[256];
+    long kb = -1;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    f = fopen(path, "r");
+    if (!f)
+        return -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "VmRSS:", 6) == 0) {
+            kb = atol(line + 6);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+/*
+ * 起 k 个常驻子进程 (exec 为真时先 exec 成 --idle)，等它们都就绪后
+ * 看 meminfo 的增长和子进程的 RSS
+ */
+static void bench_footprint(const char *name, int k, int exec)
+{
+    long before[NR_MEMINFO] = { 0 }, after[NR_MEMINFO] = { 0 };
+    pid_t *pids = calloc(k, sizeof(*pids));
+    int ready[2], hold[2];
+    long rss = 0;
+    int started = 0;
+    char c;
+
+    if (!pids || pipe(ready) != 0 || pipe(hold) != 0)
+        return;
+
+    read_meminfo(before);
+    for (; started < k; started++) {
+        pid_t pid = fork();
+        if (pid < 0)
+            break;
+        if (pid == 0) {
+            close(ready[0]);
+            close(hold[1]);
+            if (exec) {
+                char sr[16], sh[16];
+                snprintf(sr, sizeof(sr), "%d", ready[1]);
+                snprintf(sh, sizeof(sh), "%d", hold[0]);
+                char *argv[] = { self_path, "--idle", sr, sh, NULL };
+                execve(self_path, argv, environ);
+                _exit(1);
+            }
+            // 就绪后一直阻塞，直到父进程关掉 hold
+            if (write(ready[1], "x", 1) != 1)
+                _exit(1);
+            while (read(hold[0], &c, 1) > 0)
+                ;
+            _exit(0);
+        }
+        pids[started] = pid;
+    }
+    close(ready[1]);
+    close(hold[0]);
+    for (int i = 0; i < started; i++) {
+        if (read(ready[0], &c, 1) != 1)
+            break;
+    }
+    read_meminfo(after);
+    for (int i = 0; i < started; i++)
+        rss += proc_rss_kb(pids[i]);
+
+    close(hold[1]);
+    close(ready[0]);
+    for (int i = 0; i < started; i++)
+        reap(pids[i]);
+
+    printf("%s    {\"name\": \"%s\", \"procs\": %d", first_result ? "" : ",\n", name, started);
+    if (started > 0) {
+        for (size_t i = 0; i < NR_MEMINFO; i++)
+            printf(", \"%s_kb_per_proc\": %.2f", meminfo_keys[i],
+                   (double)(after[i] - before[i]) / started);
+        printf(", \"VmRSS_kb_per_proc\": %.1f", (double)rss / started);
+    }
+    printf("}");
+    first_result = 0;
+    free(pids);
+}
+
+static int has_vtask(void)
+{
+    FILE *f = fopen("/proc/self/maps", "r");
+    char line[512];
+    int found = 0;
+
+    if (!f)
+        return 0;
+    while (!found && fgets(line, sizeof(line), f))
+        found = strstr(line, "[vtask]") != NULL;
+    fclose(f);
+    return found;
+}
+
+// 写一个键再读回来，别的内核上同号的系统调用不会碰巧返回同样的值
+static int has_kv_store(void)
+{
+    const int key = 0x5a5a0041, value = 0x12345;
+
+    return syscall(__NR_write_kv, key, value) == sizeof(int) &&
+           syscall(__NR_read_kv, key) == value;
+}
+
+static int want(const char *tests, const char *name)
+{
+    size_t len = strlen(name);
+    const char *p = tests;
+
+    if (!tests)
+        return 1;
+    while ((p = strstr(p, name)) != NULL) {
+        if ((p == tests || p[-1] == ',') && (p[len] == ',' || p[len] == '\0'))
+            return 1;
+        p += len;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    long n = 2000;
+    int k = 200, opt;
+    const char *tests = NULL, *label = "";
+
+    // 被自己 exec/spawn 出来的几种角色
+    if (argc >= 2 && strcmp(argv[1], "--child") == 0)
+        return 0;
+    if (argc >= 5 && strcmp(argv[1], "--exec-chain") == 0) {
+        ssize_t len = readlink("/proc/self/exe", self_path, sizeof(self_path) - 1);
+        self_path[len > 0 ? len : 0] = '\0';
+        return exec_chain(atoi(argv[2]), atol(argv[3]), strtoull(argv[4], NULL, 10));
+    }
+    if (argc >= 4 && strcmp(argv[1], "--idle") == 0) {
+        char c;
+        if (write(atoi(argv[2]), "x", 1) != 1)
+            return 1;
+        while (read(atoi(argv[3]), &c, 1) > 0)
+            ;
+        return 0;
+    }
+
+    while ((opt = getopt(argc, argv, "n:k:t:l:")) != -1) {
+        switch (opt) {
+        case 'n': n = atol(optarg); break;
+        case 'k': k = atoi(optarg); break;
+        case 't': tests = optarg; break;
+        case 'l': label = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-n ops] [-k idle_procs] [-t fork,vfork,thread,spawn,exec] [-l label]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (n < 1 || k < 1)
+        return 1;
+
+    ssize_t len = readlink("/proc/self/exe", self_path, sizeof(self_path) - 1);
+    if (len <= 0) {
+        perror("readlink /proc/self/exe");
+        return 1;
+    }
+    self_path[len] = '\0';
+
+    uint64_t *lat = calloc(n, sizeof(*lat));
+    if (!lat)
+        return 1;
+
+    static const struct {
+        const char *name;
+        int (*fn)(uint64_t *, long);
+    } benches[] = {
+        { "fork", bench_fork },
+        { "vfork", bench_vfork },
+        { "thread", bench_thread },
+        { "spawn", bench_spawn },
+        { "exec", bench_exec },
+    };
+
+    struct utsname uts;
+    uname(&uts);
+    printf("{\n");
+    printf("  \"label\": \"%s\",\n", label);
+    printf("  \"kernel\": \"%s\",\n", uts.release);
+    printf("  \"features\": {\"vtask\": %s, \"kv_store\": %s},\n",
+           has_vtask() ? "true" : "false", has_kv_store() ? "true" : "false");
+    printf("  \"results\": [\n");
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (!want(tests, benches[i].name))
+            continue;
+        // 先跑一小段预热 (页缓存、slab)，不计入结果
+        benches[i].fn(lat, n < 50 ? n : 50);
+        uint64_t t0 = now_ns();
+        if (benches[i].fn(lat, n) != 0) {
+            fprintf(stderr, "%s: %s\n", benches[i].name, strerror(errno));
+            continue;
+        }
+        report(benches[i].name, lat, n, now_ns() - t0);
+    }
+    printf("\n  ],\n  \"footprint\": [\n");
+    first_result = 1;
+    bench_footprint("fork", k, 0);
+    bench_footprint("fork+exec", k, 1);
+    printf("\n  ]\n}\n");
+
+    free(lat);
+    return 0;
+}
@@ -0,0 +1,253 @@
+/*
+ * vDSO 延迟基准: 对比系统调用、vDSO 调用和直接读 vtask 页的开销
+ *
+ * 用法: ./bench_vdso [-c cpu] [-n samples] [-m cold_samples] [-b evict_mb] > result.json
+ *
+ * 每个调用都用 rdtsc 单独计时 (减去空测量的开销)，结果以 JSON 输出，
+ * 包含每项的百分位数和 log2(cycles) 直方图。warm 表示连续调用；
+ * cold 表示每次调用前先扫一遍大缓冲区把缓存冲掉。
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <sched.h>
+#include <string>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <vector>
+#include <x86intrin.h>
+#include "vdso_sym.h"
+#include "../kv_syscall/kv_syscalls.h"
+
+static inline uint64_t tsc_begin()
+{
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+}
+
+static inline uint64_t tsc_end()
+{
+    unsigned aux;
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+}
+
+// 用 CLOCK_MONOTONIC 标定 TSC 频率
+static double calibrate_tsc_ghz()
+{
+    struct timespec a, b;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    uint64_t t0 = tsc_begin();
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &b);
+    } while ((b.tv_sec - a.tv_sec) * 1000000000LL + (b.tv_nsec - a.tv_nsec) < 100000000LL);
+    uint64_t t1 = tsc_end();
+    double ns = (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+    return (t1 - t0) / ns;
+}
+
+static std::vector<char> evict_buf;
+volatile long sink;     // 防止被测调用被优化掉
+
+// 按 cache line 扫一遍缓冲区，冲掉 L1/L2/LLC 中的内容
+static void evict_caches()
+{
+    volatile char *p = evict_buf.data();
+    for (size_t i = 0; i < evict_buf.size(); i += 64)
+        p[i]++;
+}
+
+struct Bench {
+    std::string name;       // 被测操作
+    std::string path;       // syscall / vdso / vtask_page / tsc
+    bool available;
+    std::function<void()> fn;
+};
+
+struct Result {
+    const Bench *bench;
+    const char *cache;
+    std::vector<uint64_t> cycles;
+};
+
+static uint64_t measure_overhead()
+{
+    std::vector<uint64_t> s(10000);
+    for (auto &v : s) {
+        uint64_t t0 = tsc_begin();
+        v = tsc_end() - t0;
+    }
+    std::sort(s.begin(), s.end());
+    return s[s.size() / 2];
+}
+
+static Result run(const Bench &b, bool cold, size_t samples, uint64_t overhead)
+{
+    Result r{&b, cold ? "cold" : "warm", {}};
+    r.cycles.reserve(samples);
+
+    for (size_t i = 0; i < samples / 10 + 1; i++)
+        b.fn();
+
+    for (size_t i = 0; i < samples; i++) {
+        if (cold)
+            evict_caches();
+        uint64_t t0 = tsc_begin();
+        b.fn();
+        uint64_t t1 = tsc_end();
+        uint64_t d = t1 - t0;
+        r.cycles.push_back(d > overhead ? d - overhead : 0);
+    }
+    std::sort(r.cycles.begin(), r.cycles.end());
+    return r;
+}
+
+static uint64_t pct(const std::vector<uint64_t> &v, double p)
+{
+    size_t i = (size_t)(p / 100.0 * (v.size() - 1));
+    return v[i];
+}
+
+static void print_result(const Result &r, double ghz, bool last)
+{
+    const auto &v = r.cycles;
+    double sum = 0;
+    for (auto c : v)
+        sum += c;
+    double mean = v.empty() ? 0 : sum / v.size();
+
+    printf("    {\"name\": \"%s\", \"path\": \"%s\", \"cache\": \"%s\", \"samples\": %zu, "
+           "\"cycles\": {\"min\": %llu, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, "
+           "\"p999\": %llu, \"max\": %llu, \"mean\": %.1f}, \"p50_ns\": %.1f, \"mean_ns\": %.1f, ",
+           r.bench->name.c_str(), r.bench->path.c_str(), r.cache, v.size(),
+           (unsigned long long)v.front(), (unsigned long long)pct(v, 50),
+           (unsigned long long)pct(v, 90), (unsigned long long)pct(v, 99),
+           (unsigned long long)pct(v, 99.9), (unsigned long long)v.back(),
+           mean, pct(v, 50) / ghz, mean / ghz);
+
+    // log2 直方图: [下界 cycles, 样本数]
+    uint64_t hist[64] = {};
+    for (auto c : v)
+        hist[c ? 63 - __builtin_clzll(c) : 0]++;
+    printf("\"histogram\": [");
+    bool first = true;
+    for (int i = 0; i < 64; i++) {
+        if (!hist[i])
+            continue;
+        printf("%s[%llu, %llu]", first ? "" : ", ",
+               i ? 1ULL << i : 0ULL, (unsigned long long)hist[i]);
+        first = false;
+    }
+    printf("]}%s\n", last ? "" : ",");
+}
+
+static void print_unavailable(const Bench &b, bool last)
+{
+    printf("    {\"name\": \"%s\", \"path\": \"%s\", \"available\": false}%s\n",
+           b.name.c_str(), b.path.c_str(), last ? "" : ",");
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-c cpu] [-n samples] [-m cold_samples] [-b evict_mb]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    int cpu = 0;
+    size_t samples = 100000, cold_samples = 2000, evict_mb = 32;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:n:m:b:")) != -1) {
+        switch (opt) {
+        case 'c': cpu = atoi(optarg); break;
+        case 'n': samples = strtoul(optarg, NULL, 0); break;
+        case 'm': cold_samples = strtoul(optarg, NULL, 0); break;
+        case 'b': evict_mb = strtoul(optarg, NULL, 0); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (!samples || !cold_samples)
+        usage(argv[0]);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        perror("sched_setaffinity");
+        return 1;
+    }
+
+    evict_buf.assign(evict_mb << 20, 0);
+
+    const volatile struct vtask_data *self = vtask_self();
+    bool kv_ok = write_kv(1, 1) != -1 || errno != ENOSYS;
+    bool kv_private_ok = write_kv_flags(1, 1, KV_PRIVATE) != -1 || errno != ENOSYS;
+
+    struct task_info info;
+    struct timespec ts;
+    unsigned c, n;
+    uint64_t ns;
+
+    std::vector<Bench> benches = {
+        {"rdtsc", "tsc", true, [] { sink = __rdtsc(); }},
+        {"get_task_struct_info", "vdso", vdso.get_task_struct_info != NULL,
+         [&] { sink = vdso.get_task_struct_info(&info); }},
+        {"getpid", "syscall", true, [] { sink = syscall(SYS_getpid); }},
+        {"getpid", "vdso", vdso.getpid != NULL, [] { sink = vdso.getpid(); }},
+        {"getpid", "vtask_page", self != NULL, [] { sink = vtask_getpid(); }},
+        {"gettid", "syscall", true, [] { sink = syscall(SYS_gettid); }},
+        {"gettid", "vtask_page", self != NULL, [] { sink = vtask_gettid(); }},
+        {"getcpu", "syscall", true, [&] { sink = syscall(SYS_getcpu, &c, &n, NULL); }},
+        {"getcpu", "vdso", vdso.getcpu != NULL, [&] { sink = vdso.getcpu(&c, &n, NULL); }},
+        {"getcpu", "vtask_page", self != NULL, [] { sink = vtask_getcpu(); }},
+        {"clock_gettime_monotonic", "syscall", true,
+         [&] { sink = syscall(SYS_clock_gettime, CLOCK_MONOTONIC, &ts); }},
+        {"clock_gettime_monotonic", "vdso", vdso.clock_gettime != NULL,
+         [&] { sink = vdso.clock_gettime(CLOCK_MONOTONIC, &ts); }},
+        {"clock_gettime_thread_cputime", "syscall", true,
+         [&] { sink = syscall(SYS_clock_gettime, CLOCK_THREAD_CPUTIME_ID, &ts); }},
+        {"clock_gettime_thread_cputime", "vdso", vdso.thread_cputime != NULL && self != NULL &&
+             vdso.thread_cputime((const struct vtask_data *)self, &ns) == 0,
+         [&] { sink = vdso.thread_cputime((const struct vtask_data *)self, &ns); }},
+        // read_kv 没有 vDSO 路径，私有模式是不加锁的系统调用
+        {"read_kv", "syscall", kv_ok, [] { sink = read_kv(1); }},
+        {"read_kv_private", "syscall", kv_private_ok, [] { sink = read_kv_flags(1, KV_PRIVATE); }},
+    };
+
+    double ghz = calibrate_tsc_ghz();
+    uint64_t overhead = measure_overhead();
+    struct utsname uts;
+    uname(&uts);
+
+    printf("{\n");
+    printf("  \"kernel\": \"%s\",\n", uts.release);
+    printf("  \"cpu\": %d,\n", cpu);
+    printf("  \"tsc_ghz\": %.4f,\n", ghz);
+    printf("  \"tsc_overhead_cycles\": %llu,\n", (unsigned long long)overhead);
+    printf("  \"evict_mb\": %zu,\n", evict_mb);
+    printf("  \"results\": [\n");
+    for (size_t i = 0; i < benches.size(); i++) {
+        const Bench &b = benches[i];
+        bool last = i + 1 == benches.size();
+        if (!b.available) {
+            print_unavailable(b, last);
+            continue;
+        }
+        Result warm = run(b, false, samples, overhead);
+        print_result(warm, ghz, false);
+        Result cold = run(b, true, cold_samples, overhead);
+        print_result(cold, ghz, last);
+    }
+    printf("  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include "vdso_sym.h"
+
+struct proc_psi {
+    double avg[3];
+    unsigned long long total;
+};
+
+// 解析 /proc/pressure/memory 中以 @kind ("some"/"full") 开头的一行
+static bool read_proc_psi(const char *kind, struct proc_psi *out)
+{
+    FILE *f = fopen("/proc/pressure/memory", "r");
+    if (!f)
+        return false;
+    char line[256];
+    bool found = false;
+    while (fgets(line, sizeof(line), f)) {
+        char name[8];
+        if (sscanf(line, "%7s avg10=%lf avg60=%lf avg300=%lf total=%llu", name,
+                   &out->avg[0], &out->avg[1], &out->avg[2], &out->total) == 5 &&
+            strcmp(name, kind) == 0) {
+            found = true;
+            break;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+static unsigned long long now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int main()
+{
+    if (!vdso.psi_data || !vdso.mem_pressure) {
+        fprintf(stderr, "symbol not found\n");
+        return 1;
+    }
+
+    struct vpsi_data snap;
+    if (vdso.mem_pressure(&snap) != 0) {
+        fprintf(stderr, "PSI disabled in kernel\n");
+        return 1;
+    }
+
+    // Test 1: 快照字段合理
+    assert(snap.version >= VPSI_DATA_VERSION);
+    assert((snap.seq & 1) == 0);
+    for (int w = 0; w < 3; w++) {
+        assert(snap.some_avg[w] <= 10000);
+        assert(snap.full_avg[w] <= 10000);
+    }
+    assert(snap.full_total <= snap.some_total);
+    printf("Test 1 passed: some avg10=%u.%02u%% total=%lluus events=%llu\n",
+           snap.some_avg[0] / 100, snap.some_avg[0] % 100,
+           (unsigned long long)snap.some_total, (unsigned long long)snap.events);
+
+    // Test 2: 与 /proc/pressure/memory 对比，vDSO 的累计值不会超过之后读到的
+    struct proc_psi some;
+    assert(read_proc_psi("some", &some));
+    assert(snap.some_total <= some.total);
+    printf("Test 2 passed: /proc some total=%lluus\n", some.total);
+
+    // Test 3: 页面会被周期性刷新
+    std::this_thread::sleep_for(std::chrono::milliseconds(3 * VPSI_PERIOD_MS));
+    struct vpsi_data later;
+    assert(vdso.mem_pressure(&later) == 0);
+    assert(later.update_ns > snap.update_ns);
+    assert(now_ns() - later.update_ns < 4ULL * VPSI_PERIOD_MS * 1000000);
+    assert(later.events >= snap.events);
+    assert(later.some_total >= snap.some_total);
+    printf("Test 3 passed: refreshed %.1f ms ago\n", (now_ns() - later.update_ns) / 1e6);
+
+    // 分配器慢路径上的用法: 只比较 events
+    const volatile struct vpsi_data *vp = vdso.psi_data();
+    const int iters = 10000000;
+    unsigned long long seen = vp->events, changes = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++) {
+        unsigned long long ev = vp->events;
+        if (ev != seen) {
+            seen = ev;
+            changes++;
+        }
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - t0).count();
+    printf("events check: %.2f ns/check (%llu changes)\n", (double)ns / iters, changes);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters / 10; i++)
+        vdso.mem_pressure(&snap);
+    ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - t0).count();
+    printf("__vdso_mem_pressure: %.1f ns/call\n", (double)ns / (iters / 10));
+
+    printf("All mem_pressure tests PASSED!\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include "vdso_sym.h"
+
+#define NUM_THREADS 8
+#define NUM_SAMPLES 100000
+// vDSO 的值不包含 "被调度进来" 到 "记录 TSC" 之间的一小段时间
+#define TOLERANCE_NS 200000
+
+static uint64_t kernel_cputime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *thread_func(void *)
+{
+    const struct vtask_data *self = (const struct vtask_data *)vtask_self();
+    assert(self != NULL);
+
+    uint64_t last = 0;
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        uint64_t before = kernel_cputime();
+        uint64_t ns;
+        if (vdso.thread_cputime(self, &ns) != 0) {
+            fprintf(stderr, "vDSO thread cputime unavailable (clocksource is not tsc?)\n");
+            exit(1);
+        }
+        uint64_t after = kernel_cputime();
+
+        // 单调递增
+        if (ns < last) {
+            fprintf(stderr, "went backwards: %llu -> %llu\n",
+                    (unsigned long long)last, (unsigned long long)ns);
+            exit(1);
+        }
+        last = ns;
+
+        // 落在两次系统调用之间 (两侧都允许少量误差: vDSO 从 switch_tsc
+        // 外推，不扣除中断时间，取样点也和内核不同，可能略大于 after)
+        if (ns > after + TOLERANCE_NS || ns + TOLERANCE_NS < before) {
+            fprintf(stderr, "out of range: before=%llu vdso=%llu after=%llu\n",
+                    (unsigned long long)before, (unsigned long long)ns,
+                    (unsigned long long)after);
+            exit(1);
+        }
+
+        if (i % 1000 == 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+int main()
+{
+    if (!vdso.thread_cputime) {
+        fprintf(stderr, "symbol not found\n");
+        return 1;
+    }
+
+    printf("Testing vDSO thread cputime with %d threads...\n", NUM_THREADS);
+    pthread_t threads[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++)
+        pthread_create(&threads[i], NULL, thread_func, NULL);
+    for (int i = 0; i < NUM_THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    printf("All thread cputime tests PASSED!\n");
+    return 0;
+}
@@ -4,41 +4,15 @@
 #include <string>
 #include <unistd.h>
 #include <cstdlib>
-#include <dlfcn.h>
 #include <sys/wait.h>
-
-extern "C" {
-
-struct task_info {
-    void *task_struct_ptr;
-    pid_t pid;
-    // other key fields...
-};
-
-int get_task_struct_info(struct task_info *info);
-
-
-static void *func_sym = NULL;
+#include "vdso_sym.h"
 
 int get_task_struct_info(struct task_info *info) {
-    if (func_sym == NULL) {
-        void *handle = dlopen("linux-vdso.so.1", RTLD_LAZY);
-        if (!handle) {
-            std::cerr << "vdso not found" << std::endl;
-            return -1;
-        }
-        func_sym = dlsym(handle, "__vdso_get_task_struct_info");
-        if (!func_sym) {
-            std::cerr << "symbol not found" << std::endl;
-            dlclose(handle);
-            return -1;
-        }
+    if (vdso.get_task_struct_info == NULL) {
+        std::cerr << "symbol not found" << std::endl;
+        return -1;
     }
-    int (*get_task_struct_info_func)(struct task_info *out) = (int (*)(struct task_info *))func_sym;
-    int ret = get_task_struct_info_func(info);
-    return ret;
-}
-
+    return vdso.get_task_struct_info(info);
 }
 
 int main() {
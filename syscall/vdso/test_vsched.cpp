@@ -0,0 +1,90 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <unistd.h>
+#include "vdso_sym.h"
+
+#define NUM_SPINNERS 3
+
+static std::atomic<bool> stop_spin;
+
+static void pin_to(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    assert(sched_setaffinity(0, sizeof(set), &set) == 0);
+}
+
+static void *spin(void *)
+{
+    pin_to(0);
+    while (!stop_spin.load(std::memory_order_relaxed))
+        ;
+    return NULL;
+}
+
+int main()
+{
+    if (!vdso.sched_hint || !vdso.sched_data) {
+        fprintf(stderr, "symbol not found\n");
+        return 1;
+    }
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    const struct vsched_data *vs = vdso.sched_data();
+    struct vsched_hint hint;
+
+    pin_to(0);
+
+    // Test 1: 基本字段
+    assert(vs->version >= VSCHED_DATA_VERSION);
+    assert(vs->nr_cpus >= (unsigned)online);
+    assert(vdso.sched_hint(&hint) == 0);
+    assert(hint.cpu == 0);
+    assert(hint.nr_cpus == vs->nr_cpus);
+    assert(hint.nr_idle <= hint.nr_cpus);
+    assert(hint.nr_running >= 1);   // 至少有调用者自己
+    printf("Test 1 passed: nr_cpus=%u nr_idle=%u nr_running(cpu0)=%u\n",
+           hint.nr_cpus, hint.nr_idle, hint.nr_running);
+
+    // Test 2: 在 CPU 0 上跑几个忙等线程，runqueue 长度应随之增长
+    pthread_t threads[NUM_SPINNERS];
+    for (int i = 0; i < NUM_SPINNERS; i++)
+        pthread_create(&threads[i], NULL, spin, NULL);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    assert(vdso.sched_hint(&hint) == 0);
+    assert(hint.cpu == 0);
+    assert(hint.nr_running >= NUM_SPINNERS + 1);
+    assert(vs->cpus[0].nr_running >= NUM_SPINNERS + 1);
+    printf("Test 2 passed: nr_running(cpu0)=%u with %d spinners\n",
+           hint.nr_running, NUM_SPINNERS);
+
+    stop_spin = true;
+    for (int i = 0; i < NUM_SPINNERS; i++)
+        pthread_join(threads[i], NULL);
+
+    // Test 3: 线程退出后 runqueue 变短
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(vdso.sched_hint(&hint) == 0);
+    assert(hint.nr_running < NUM_SPINNERS + 1);
+    printf("Test 3 passed: nr_running(cpu0)=%u after join\n", hint.nr_running);
+
+    // 单次调用开销
+    const int iters = 1000000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++)
+        vdso.sched_hint(&hint);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - t0).count();
+    printf("__vdso_sched_hint: %.1f ns/call\n", (double)ns / iters);
+
+    printf("All vsched tests PASSED!\n");
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "vdso_sym.h"
+
+static void check_vdso()
+{
+    if (!vdso.get_task_data || !vdso.getpid) {
+        fprintf(stderr, "symbol not found\n");
+        exit(1);
+    }
+}
+
+static void check_self(struct vtask_data *out)
+{
+    assert(vdso.get_task_data(out) == 0);
+    assert(out->version >= VTASK_DATA_VERSION);
+    assert((out->seq & 1) == 0);
+    assert(out->pid == getpid());
+    assert(vdso.getpid() == getpid());
+
+    unsigned cpu, node;
+    assert(syscall(SYS_getcpu, &cpu, &node, NULL) == 0);
+    // 两次读取之间可能被迁移，只检查范围
+    assert(out->cpu < (unsigned)sysconf(_SC_NPROCESSORS_CONF));
+}
+
+int main()
+{
+    struct vtask_data data;
+
+    check_vdso();
+
+    // Test 1: 当前进程
+    check_self(&data);
+    // 每进程页里的 tid 只属于主线程，get_task_data 不返回它
+    assert(data.tid == 0);
+    if (vdso.gettid) {
+        assert(vdso.gettid(NULL) == syscall(SYS_gettid));
+        assert(vdso.gettid((const struct vtask_data *)vtask_self()) == syscall(SYS_gettid));
+    }
+    printf("Test 1 passed: pid=%d generation=%llu cpu=%u\n",
+           data.pid, (unsigned long long)data.generation, data.cpu);
+
+    // Test 2: fork 后子进程看到自己的 pid 和新的 generation
+    for (int i = 0; i < 5; i++) {
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            struct vtask_data child;
+            check_self(&child);
+            if (child.generation == data.generation) {
+                fprintf(stderr, "generation not changed after fork\n");
+                exit(1);
+            }
+            exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    printf("Test 2 passed: fork children\n");
+
+    // Test 3: 父进程的数据不受子进程影响
+    struct vtask_data again;
+    check_self(&again);
+    assert(again.generation == data.generation);
+    printf("Test 3 passed: parent unchanged\n");
+
+    printf("All vtask tests PASSED!\n");
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <sched.h>
+#include <set>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "vdso_sym.h"
+
+#define NUM_THREADS 64
+#define NUM_ROUNDS 200
+
+static int ncpu;
+static pthread_barrier_t barrier;
+static std::atomic<int> failures(0);
+static const volatile struct vtask_data *pages[NUM_THREADS];
+
+static void fail(int id, const char *what, long expected, long got)
+{
+    fprintf(stderr, "thread %d: %s mismatch, expected %ld got %ld\n", id, what, expected, got);
+    failures++;
+}
+
+static void *thread_func(void *arg)
+{
+    int id = *(int *)arg;
+    pid_t tid = syscall(SYS_gettid);
+    struct vtask_data d;
+
+    const volatile struct vtask_data *self = vtask_self();
+    if (!self) {
+        perror("vtask_register");
+        exit(1);
+    }
+    pages[id] = self;
+    pthread_barrier_wait(&barrier);
+
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        // 每一轮把线程迁移到另一个 CPU
+        int cpu = (id + round) % ncpu;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            perror("sched_setaffinity");
+            exit(1);
+        }
+
+        assert(vtask_read(&d) == 0);
+        if (d.tid != tid)
+            fail(id, "tid", tid, d.tid);
+        if (d.pid != getpid())
+            fail(id, "pid", getpid(), d.pid);
+        // 绑定到单个 CPU 之后，cpu 只能是这一个
+        if (d.cpu != (unsigned)cpu)
+            fail(id, "cpu", cpu, d.cpu);
+        if ((int)vtask_getcpu() != sched_getcpu())
+            fail(id, "getcpu", sched_getcpu(), vtask_getcpu());
+        if (vtask_gettid() != tid)
+            fail(id, "gettid", tid, vtask_gettid());
+        pid_t vtid = vdso.gettid ? vdso.gettid((const struct vtask_data *)self) : tid;
+        if (vtid != tid)
+            fail(id, "vdso gettid", tid, vtid);
+        // 每进程页只有主线程的 tid，get_task_data 把它清掉
+        if (vdso.get_task_data && (vdso.get_task_data(&d) != 0 || d.tid != 0))
+            fail(id, "get_task_data tid", 0, d.tid);
+
+        if (round % 16 == 0)
+            sched_yield();
+    }
+
+    pthread_barrier_wait(&barrier);
+    return NULL;
+}
+
+int main()
+{
+    pthread_t threads[NUM_THREADS];
+    int ids[NUM_THREADS];
+
+    ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("Testing per-thread vtask pages with %d threads on %d CPUs...\n",
+           NUM_THREADS, ncpu);
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        ids[i] = i;
+        pthread_create(&threads[i], NULL, thread_func, &ids[i]);
+    }
+    for (int i = 0; i < NUM_THREADS; i++)
+        pthread_join(threads[i], NULL);
+    pthread_barrier_destroy(&barrier);
+
+    // 每个线程拿到的页互不相同
+    std::set<const volatile void *> distinct(pages, pages + NUM_THREADS);
+    assert(distinct.size() == NUM_THREADS);
+
+    // 主线程自己的页
+    struct vtask_data d;
+    assert(vtask_read(&d) == 0);
+    assert(d.tid == getpid() && d.pid == getpid());
+
+    // 子进程的线程页被清掉了, 缓存的地址必须重新注册而不是直接读 (会 SIGBUS)
+    pid_t child = fork();
+    if (child == 0) {
+        struct vtask_data c;
+        _exit(vtask_read(&c) == 0 && c.pid == getpid() && vtask_getpid() == getpid() ? 0 : 1);
+    }
+    int status;
+    assert(waitpid(child, &status, 0) == child);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(vtask_unregister() == 0);
+
+    if (failures) {
+        printf("%d mismatches, FAILED\n", failures.load());
+        return 1;
+    }
+    printf("All per-thread vtask tests PASSED!\n");
+    return 0;
+}
@@ -0,0 +1,196 @@
+#ifndef _VDSO_SYM_H
+#define _VDSO_SYM_H
+
+/*
+ * Header-only 的 vDSO 符号解析
+ *
+ * 不用 dlopen("linux-vdso.so.1") + dlsym: 那样要链接 libdl、会拿 loader
+ * 的锁，而且在 -static 程序里根本找不到 vDSO。这里直接从
+ * getauxval(AT_SYSINFO_EHDR) 拿到内核映射的 vDSO ELF 头，启动时 (constructor)
+ * 遍历一次动态符号表，把我们关心的入口填进 vdso 函数指针表。之后的调用
+ * 就是一次普通的间接调用，没有锁，也不会再解析。
+ *
+ * 用法:
+ *     #include "vdso_sym.h"
+ *     if (vdso.getpid) pid = vdso.getpid();
+ *
+ * 内核不提供的入口保持为 NULL；其它符号可以用 vdso_sym("__vdso_xxx") 查。
+ * C 和 C++ 都可以用。
+ */
+
+#include <elf.h>
+#include <link.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/auxv.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include "vtask.h"
+
+/* __vdso_get_task_struct_info 的输出 */
+struct task_info {
+    void *task_struct_ptr;
+    pid_t pid;
+};
+
+struct vdso_funcs {
+    /* 自定义入口 */
+    int (*get_task_struct_info)(struct task_info *info);
+    int (*get_task_data)(struct vtask_data *out);
+    pid_t (*getpid)(void);
+    pid_t (*gettid)(const struct vtask_data *self);
+    int (*thread_cputime)(const struct vtask_data *self, uint64_t *ns);
+    int (*vtask_getcpu)(const struct vtask_data *self, unsigned *cpu, unsigned *node);
+    const struct vsched_data *(*sched_data)(void);
+    int (*sched_hint)(struct vsched_hint *out);
+    const struct vpsi_data *(*psi_data)(void);
+    int (*mem_pressure)(struct vpsi_data *out);
+    /* 内核自带的入口 */
+    int (*clock_gettime)(clockid_t clk, struct timespec *ts);
+    int (*clock_getres)(clockid_t clk, struct timespec *ts);
+    int (*gettimeofday)(struct timeval *tv, void *tz);
+    time_t (*time)(time_t *t);
+    long (*getcpu)(unsigned *cpu, unsigned *node, void *cache);
+};
+
+static struct vdso_funcs vdso;
+
+static const struct {
+    const char *name;
+    size_t offset;
+} vdso_sym_table[] = {
+    { "__vdso_get_task_struct_info", offsetof(struct vdso_funcs, get_task_struct_info) },
+    { "__vdso_get_task_data",        offsetof(struct vdso_funcs, get_task_data) },
+    { "__vdso_getpid",               offsetof(struct vdso_funcs, getpid) },
+    { "__vdso_gettid",               offsetof(struct vdso_funcs, gettid) },
+    { "__vdso_thread_cputime",       offsetof(struct vdso_funcs, thread_cputime) },
+    { "__vdso_vtask_getcpu",         offsetof(struct vdso_funcs, vtask_getcpu) },
+    { "__vdso_sched_data",           offsetof(struct vdso_funcs, sched_data) },
+    { "__vdso_sched_hint",           offsetof(struct vdso_funcs, sched_hint) },
+    { "__vdso_psi_data",             offsetof(struct vdso_funcs, psi_data) },
+    { "__vdso_mem_pressure",         offsetof(struct vdso_funcs, mem_pressure) },
+    { "__vdso_clock_gettime",        offsetof(struct vdso_funcs, clock_gettime) },
+    { "__vdso_clock_getres",         offsetof(struct vdso_funcs, clock_getres) },
+    { "__vdso_gettimeofday",         offsetof(struct vdso_funcs, gettimeofday) },
+    { "__vdso_time",                 offsetof(struct vdso_funcs, time) },
+    { "__vdso_getcpu",               offsetof(struct vdso_funcs, getcpu) },
+};
+
+/* 解析出的动态符号表，vdso_sym() 复用 */
+static struct {
+    uintptr_t load_offset;
+    const ElfW(Sym) *symtab;
+    const char *strtab;
+    size_t nsyms;
+} vdso_elf;
+
+/*
+ * 只有 DT_GNU_HASH 时符号个数要从哈希表推出来:
+ * 最大的 bucket 起始下标, 再沿 chain 走到末尾标记 (最低位为 1)
+ */
+static inline size_t vdso_gnu_hash_nsyms(const uint32_t *gh)
+{
+    uint32_t nbuckets = gh[0], symoffset = gh[1], bloom_size = gh[2];
+    const uint32_t *buckets = gh + 4 + bloom_size * (sizeof(ElfW(Addr)) / 4);
+    const uint32_t *chain = buckets + nbuckets;
+    uint32_t max = 0;
+
+    for (uint32_t i = 0; i < nbuckets; i++)
+        if (buckets[i] > max)
+            max = buckets[i];
+    if (max < symoffset)
+        return symoffset;
+    while (!(chain[max - symoffset] & 1))
+        max++;
+    return max + 1;
+}
+
+/**
+ * @brief 解析 vDSO 并填充 vdso 函数指针表
+ * @return 成功返回 0，没有 vDSO 或格式不认识返回 -1
+ * @note 由 constructor 在 main 之前调用一次，通常不需要手动调用
+ */
+static inline int vdso_sym_init(void)
+{
+    const ElfW(Ehdr) *eh = (const ElfW(Ehdr) *)getauxval(AT_SYSINFO_EHDR);
+    if (!eh || memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 ||
+        eh->e_ident[EI_CLASS] != ELFCLASS64)
+        return -1;
+
+    const ElfW(Phdr) *ph = (const ElfW(Phdr) *)((const char *)eh + eh->e_phoff);
+    const ElfW(Dyn) *dyn = NULL;
+    uintptr_t load_offset = 0;
+    int found_load = 0;
+
+    for (int i = 0; i < eh->e_phnum; i++) {
+        if (ph[i].p_type == PT_LOAD && !found_load) {
+            found_load = 1;
+            load_offset = (uintptr_t)eh + ph[i].p_offset - ph[i].p_vaddr;
+        } else if (ph[i].p_type == PT_DYNAMIC) {
+            dyn = (const ElfW(Dyn) *)((const char *)eh + ph[i].p_offset);
+        }
+    }
+    if (!found_load || !dyn)
+        return -1;
+
+    const ElfW(Sym) *symtab = NULL;
+    const char *strtab = NULL;
+    const uint32_t *hash = NULL, *gnu_hash = NULL;
+
+    for (; dyn->d_tag != DT_NULL; dyn++) {
+        uintptr_t p = dyn->d_un.d_ptr + load_offset;
+        switch (dyn->d_tag) {
+        case DT_SYMTAB:   symtab = (const ElfW(Sym) *)p; break;
+        case DT_STRTAB:   strtab = (const char *)p; break;
+        case DT_HASH:     hash = (const uint32_t *)p; break;
+        case DT_GNU_HASH: gnu_hash = (const uint32_t *)p; break;
+        }
+    }
+    if (!symtab || !strtab || (!hash && !gnu_hash))
+        return -1;
+
+    vdso_elf.load_offset = load_offset;
+    vdso_elf.symtab = symtab;
+    vdso_elf.strtab = strtab;
+    vdso_elf.nsyms = hash ? hash[1] : vdso_gnu_hash_nsyms(gnu_hash);
+
+    for (size_t i = 0; i < vdso_elf.nsyms; i++) {
+        const ElfW(Sym) *sym = &symtab[i];
+        if (ELF64_ST_TYPE(sym->st_info) != STT_FUNC || sym->st_shndx == SHN_UNDEF)
+            continue;
+        const char *name = strtab + sym->st_name;
+        for (size_t j = 0; j < sizeof(vdso_sym_table) / sizeof(vdso_sym_table[0]); j++) {
+            if (strcmp(name, vdso_sym_table[j].name) == 0) {
+                *(void **)((char *)&vdso + vdso_sym_table[j].offset) =
+                    (void *)(sym->st_value + load_offset);
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 查找任意 vDSO 函数符号
+ * @param name 符号名，例如 "__vdso_clock_gettime"
+ * @return 函数地址，不存在返回 NULL
+ */
+static inline void *vdso_sym(const char *name)
+{
+    for (size_t i = 0; i < vdso_elf.nsyms; i++) {
+        const ElfW(Sym) *sym = &vdso_elf.symtab[i];
+        if (ELF64_ST_TYPE(sym->st_info) == STT_FUNC && sym->st_shndx != SHN_UNDEF &&
+            strcmp(vdso_elf.strtab + sym->st_name, name) == 0)
+            return (void *)(sym->st_value + vdso_elf.load_offset);
+    }
+    return NULL;
+}
+
+__attribute__((constructor)) static void vdso_sym_ctor(void)
+{
+    vdso_sym_init();
+}
+
+#endif /* _VDSO_SYM_H */
@@ -0,0 +1,227 @@
+#ifndef _VPERCPU_H
+#define _VPERCPU_H
+
+/*
+ * 用户态 per-CPU 计数器, 基于 vpercpu_setup 映射的 [vpercpu] 区域
+ *
+ * 区域按 CPU 分成 nr_cpus 个 slot, 每个 slot stride 字节 (页对齐, 页面在
+ * vpercpu_setup 时就从该 CPU 所在节点分配好; 不可能出现的 CPU 的 slot
+ * 没有页, vpercpu_sum 跳过它们)。更新只需要:
+ *
+ *     读 vtask 页里的 cpu  ->  算出 slot  ->  addq 到 slot (提交)
+ *
+ * 不用 lock 前缀。这段代码通过 vtask_register(VTASK_SET_CS) 登记成可重启
+ * 区间: 线程在提交之前被切走 (可能迁移到别的 CPU) 或者收到信号, 内核
+ * 调度回来 / 信号处理函数返回时把它送到 abort 入口, 从头重新读 cpu。提交是一条指令, 因此同一个 slot 上不会
+ * 出现两个线程交错的读-改-写。
+ *
+ * 用法:
+ *     vpercpu_init(sizeof(struct my_counters));
+ *     vpercpu_add(offsetof(struct my_counters, hits), 1);
+ *     total = vpercpu_sum(offsetof(struct my_counters, hits));
+ *
+ * 内核不支持时 vpercpu_init 退化成普通匿名内存, vpercpu_add 退化成对
+ * sched_getcpu() 那个 slot 的原子加, 结果仍然正确, 只是慢一些。
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "vdso_sym.h"
+#include "vtask.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * vpercpu_add_cs(self, base, stride, off, value):
+ *     *(int64_t *)(base + self->cpu * stride + off) += value
+ * 放在 COMDAT 段里, 多个翻译单元包含本头文件时只保留一份。
+ */
+void vpercpu_add_cs(const volatile struct vtask_data *self, char *base,
+                    size_t stride, size_t off, int64_t value);
+extern const char vpercpu_cs_start[], vpercpu_cs_end[], vpercpu_cs_abort[];
+
+#ifdef __cplusplus
+}
+#endif
+
+__asm__(
+    "    .pushsection .text.vpercpu_add_cs,\"axG\",@progbits,vpercpu_add_cs,comdat\n"
+    "    .weak vpercpu_add_cs, vpercpu_cs_start, vpercpu_cs_end, vpercpu_cs_abort\n"
+    "    .hidden vpercpu_add_cs, vpercpu_cs_start, vpercpu_cs_end, vpercpu_cs_abort\n"
+    "    .type vpercpu_add_cs, @function\n"
+    "vpercpu_add_cs:\n"
+    "vpercpu_cs_start:\n"
+    "    movl 24(%rdi), %eax\n"         /* self->cpu */
+    "    imulq %rdx, %rax\n"
+    "    addq %rsi, %rax\n"
+    "    addq %r8, (%rax,%rcx)\n"       /* 提交 */
+    "vpercpu_cs_end:\n"
+    "    ret\n"
+    "vpercpu_cs_abort:\n"
+    "    jmp vpercpu_cs_start\n"
+    "    .size vpercpu_add_cs, .-vpercpu_add_cs\n"
+    "    .popsection\n");
+
+#ifdef __cplusplus
+static_assert(offsetof(struct vtask_data, cpu) == 24, "vpercpu_add_cs reads cpu at +24");
+#else
+_Static_assert(offsetof(struct vtask_data, cpu) == 24, "vpercpu_add_cs reads cpu at +24");
+#endif
+
+static struct {
+    char *base;
+    size_t stride;      /* 每个 CPU 的 slot 大小, 页对齐 */
+    unsigned nr_cpus;
+    int kernel;         /* 1: 由 vpercpu_setup 映射 */
+    unsigned char *present; /* kernel 时每个 slot 一字节, 0: 不可能出现的 CPU, 没有页 */
+} vpercpu_area;
+
+/* 0: 还没试过, 1: 已登记可重启区间, -1: 退化成原子加 */
+static __thread int vpercpu_thread_state;
+
+/* 子进程要重新登记 (vtask 页被清掉了, 见 vtask_atfork_child) */
+static void vpercpu_atfork_child(void)
+{
+    vpercpu_thread_state = 0;
+}
+
+/**
+ * @brief 映射 per-CPU 区域, 每个进程调用一次 (fork 出的子进程需要重新调用)
+ * @param size 每个 CPU 需要的字节数, 不超过 VPERCPU_MAX_SIZE
+ * @return 成功返回 0，失败返回 -1 并设置 errno
+ */
+static inline int vpercpu_init(size_t size)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    long addr;
+
+    if (size == 0 || size > VPERCPU_MAX_SIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (vpercpu_area.base) {
+        errno = EEXIST;
+        return -1;
+    }
+    vpercpu_area.stride = (size + page - 1) & ~(page - 1);
+
+    addr = syscall(__NR_vpercpu_setup, size, 0);
+    if (addr != -1) {
+        /* slot 个数是内核的 nr_cpu_ids, 和 [vsched] 的 nr_cpus 一致 */
+        const struct vsched_data *sd = vdso.sched_data ? vdso.sched_data() : NULL;
+        vpercpu_area.nr_cpus = sd ? sd->nr_cpus : (unsigned)sysconf(_SC_NPROCESSORS_CONF);
+        vpercpu_area.base = (char *)addr;
+        vpercpu_area.kernel = 1;
+        /* 页面在 setup 时就插好了, mincore 能看出哪些 slot 没有页, 读它们会 SIGBUS */
+        size_t npages = vpercpu_area.stride / page * vpercpu_area.nr_cpus;
+        unsigned char *vec = (unsigned char *)malloc(npages);
+        vpercpu_area.present = (unsigned char *)malloc(vpercpu_area.nr_cpus);
+        if (vec && vpercpu_area.present && mincore(vpercpu_area.base, npages * page, vec) == 0) {
+            for (unsigned cpu = 0; cpu < vpercpu_area.nr_cpus; cpu++)
+                vpercpu_area.present[cpu] = vec[cpu * (vpercpu_area.stride / page)] & 1;
+        } else {
+            free(vpercpu_area.present);
+            vpercpu_area.present = NULL;
+        }
+        free(vec);
+        return 0;
+    }
+    /* 其它内核上这个调用号可能是别的系统调用, 除 EEXIST 外一律退化 */
+    if (errno == EEXIST)
+        return -1;
+
+    vpercpu_area.nr_cpus = (unsigned)sysconf(_SC_NPROCESSORS_CONF);
+    void *p = mmap(NULL, vpercpu_area.stride * vpercpu_area.nr_cpus,
+                   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return -1;
+    vpercpu_area.base = (char *)p;
+    vpercpu_area.kernel = 0;
+    return 0;
+}
+
+/**
+ * @brief 为当前线程登记 vpercpu_add_cs 的可重启区间
+ * @return 成功返回 0, 内核不支持返回 -1 (之后该线程走原子加)
+ * @note vpercpu_add 第一次调用时自动执行
+ */
+static inline int vpercpu_thread_init(void)
+{
+    struct vtask_cs cs = {
+        (uint64_t)(uintptr_t)vpercpu_cs_start,
+        (uint64_t)(uintptr_t)vpercpu_cs_end,
+        (uint64_t)(uintptr_t)vpercpu_cs_abort,
+    };
+
+    static int atfork_registered;
+    if (!__atomic_exchange_n(&atfork_registered, 1, __ATOMIC_RELAXED))
+        pthread_atfork(NULL, NULL, vpercpu_atfork_child);
+
+    if (vpercpu_area.kernel && vtask_self() &&
+        syscall(__NR_vtask_register, VTASK_SET_CS, &cs) == 0) {
+        vpercpu_thread_state = 1;
+        return 0;
+    }
+    vpercpu_thread_state = -1;
+    return -1;
+}
+
+/**
+ * @brief 返回 cpu 的 slot 起始地址
+ */
+static inline void *vpercpu_slot(unsigned cpu)
+{
+    return vpercpu_area.base + (size_t)cpu * vpercpu_area.stride;
+}
+
+static inline void vpercpu_add_slow(size_t off, int64_t value)
+{
+    if (vpercpu_thread_state == 0 && vpercpu_thread_init() == 0) {
+        vpercpu_add_cs(vtask_self_ptr, vpercpu_area.base, vpercpu_area.stride, off, value);
+        return;
+    }
+    /*
+     * 登记失败 (例如本进程的线程数超过 VTASK_MAX_THREADS) 时, sched_getcpu() 的结果
+     * 可能已经过期, 和别的线程在同一 slot 上的非原子提交仍有极小的竞争窗口
+     */
+    int cpu = sched_getcpu();
+    if (cpu < 0 || (unsigned)cpu >= vpercpu_area.nr_cpus)
+        cpu = 0;
+    __atomic_fetch_add((int64_t *)((char *)vpercpu_slot(cpu) + off), value, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 给当前 CPU slot 中偏移 off 处的 int64_t 加上 value
+ * @note off 必须 8 字节对齐且小于 vpercpu_init 的 size
+ */
+static inline void vpercpu_add(size_t off, int64_t value)
+{
+    if (__builtin_expect(vpercpu_thread_state > 0, 1))
+        vpercpu_add_cs(vtask_self_ptr, vpercpu_area.base, vpercpu_area.stride, off, value);
+    else
+        vpercpu_add_slow(off, value);
+}
+
+/**
+ * @brief 汇总所有 CPU slot 中偏移 off 处的计数
+ * @note 和并发的 vpercpu_add 之间没有快照语义, 只保证每次加法要么计入要么不计入
+ */
+static inline int64_t vpercpu_sum(size_t off)
+{
+    int64_t sum = 0;
+
+    for (unsigned cpu = 0; cpu < vpercpu_area.nr_cpus; cpu++)
+        if (!vpercpu_area.present || vpercpu_area.present[cpu])
+            sum += __atomic_load_n((int64_t *)((char *)vpercpu_slot(cpu) + off), __ATOMIC_RELAXED);
+    return sum;
+}
+
+#endif // _VPERCPU_H
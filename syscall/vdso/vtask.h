@@ -0,0 +1,189 @@
+#ifndef _VTASK_H
+#define _VTASK_H
+
+/*
+ * 用户态使用的 vtask_data 定义，与内核 include/uapi/linux/vtask.h 保持一致
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef __NR_vtask_register
+#define __NR_vtask_register 455
+#endif
+
+#ifndef __NR_vpercpu_setup
+#define __NR_vpercpu_setup 459
+#endif
+
+#ifndef VTASK_UNREGISTER
+#define VTASK_UNREGISTER 0x1
+#endif
+
+#ifndef VTASK_SET_CS
+#define VTASK_SET_CS 0x2
+
+/* 可重启区间: 线程在 [start_ip, post_commit_ip) 内被切走时从 abort_ip 继续 */
+struct vtask_cs {
+    uint64_t start_ip;
+    uint64_t post_commit_ip;
+    uint64_t abort_ip;
+};
+#endif
+
+#ifndef VPERCPU_MAX_SIZE
+#define VPERCPU_MAX_SIZE (64 * 1024)    /* vpercpu_setup 每个 slot 的上限 */
+#endif
+
+#ifndef VTASK_DATA_VERSION
+#define VTASK_DATA_VERSION 2
+
+struct vtask_data {
+    uint32_t version;       /* VTASK_DATA_VERSION */
+    uint32_t seq;           /* seqcount, 内核更新时为奇数 */
+    uint64_t generation;    /* 页面每次 (重新) 填充时改变，例如 fork 之后 */
+    int32_t pid;            /* getpid() */
+    int32_t tid;            /* gettid() */
+    uint32_t cpu;           /* 当前 CPU */
+    uint32_t node;          /* 当前 NUMA 节点 */
+    /* version 2, 只在每线程页中维护: */
+    uint64_t sum_exec_runtime;  /* 上次被调度进来时的线程 CPU 时间 (ns) */
+    uint64_t switch_tsc;        /* 上次被调度进来时的 TSC */
+};
+#endif
+
+#ifndef VSCHED_DATA_VERSION
+#define VSCHED_DATA_VERSION 1
+
+/* 全系统的调度负载提示, 每个字段单独更新, 不需要重试 */
+struct vsched_cpu {
+    uint32_t nr_running;    /* 该 CPU runqueue 上的任务数, 0 表示空闲 */
+    uint32_t __pad[15];     /* 每个 CPU 独占一个 cache line */
+};
+
+struct vsched_data {
+    uint32_t version;       /* VSCHED_DATA_VERSION */
+    uint32_t nr_cpus;       /* cpus[] 的有效项数 */
+    uint32_t nr_idle;       /* runqueue 为空的在线 CPU 数 */
+    uint32_t __pad[13];
+    struct vsched_cpu cpus[];
+};
+
+struct vsched_hint {
+    uint32_t cpu;           /* 调用者所在 CPU */
+    uint32_t node;          /* cpu 所在 NUMA 节点 */
+    uint32_t nr_cpus;
+    uint32_t nr_idle;
+    uint32_t nr_running;    /* cpu 的 runqueue 长度, 包括调用者自己 */
+};
+#endif
+
+/* 全系统的内存压力 (/proc/pressure/memory), 每 VPSI_PERIOD_MS 刷新 */
+#ifndef VPSI_DATA_VERSION
+#define VPSI_DATA_VERSION 1
+#define VPSI_PERIOD_MS 500
+
+struct vpsi_data {
+    uint32_t version;       /* VPSI_DATA_VERSION */
+    uint32_t seq;           /* seqcount, 内核更新时为奇数 */
+    uint64_t events;        /* 看到新的 "some" stall 时间的刷新次数 */
+    uint64_t update_ns;     /* 上次刷新的 CLOCK_MONOTONIC 时间 */
+    uint32_t some_avg[3];   /* avg10/avg60/avg300, 单位 0.01% */
+    uint32_t full_avg[3];
+    uint64_t some_total;    /* 累计 stall 时间 (us) */
+    uint64_t full_total;
+};
+#endif
+
+/*
+ * 每线程 vtask 页: 第一次使用时注册, 之后地址缓存在 TLS 中,
+ * 读取只是普通的内存访问, 不进入内核
+ */
+static __thread const volatile struct vtask_data *vtask_self_ptr;
+
+/* fork 出的子进程里线程页已被清掉 ([vtask] 是 VM_WIPEONFORK), 缓存的地址作废 */
+static void vtask_atfork_child(void)
+{
+    vtask_self_ptr = NULL;
+}
+
+/**
+ * @brief 获取当前线程的 vtask_data 页
+ * @return 成功返回页地址，失败 (内核不支持等) 返回 NULL
+ */
+static inline const volatile struct vtask_data *vtask_self(void)
+{
+    if (__builtin_expect(vtask_self_ptr == NULL, 0)) {
+        static int atfork_registered;
+        if (!__atomic_exchange_n(&atfork_registered, 1, __ATOMIC_RELAXED))
+            pthread_atfork(NULL, NULL, vtask_atfork_child);
+
+        long addr = syscall(__NR_vtask_register, 0);
+        if (addr == -1)
+            return NULL;
+        vtask_self_ptr = (const volatile struct vtask_data *)addr;
+    }
+    return vtask_self_ptr;
+}
+
+/**
+ * @brief 注销当前线程的 vtask 页 (线程退出时内核会自动注销)
+ */
+static inline int vtask_unregister(void)
+{
+    vtask_self_ptr = NULL;
+    return syscall(__NR_vtask_register, VTASK_UNREGISTER);
+}
+
+/**
+ * @brief 按 seqcount 协议读取当前线程 vtask_data 的一致快照
+ * @return 成功返回 0，失败返回 -1
+ */
+static inline int vtask_read(struct vtask_data *out)
+{
+    const volatile struct vtask_data *self = vtask_self();
+    uint32_t seq;
+
+    if (!self)
+        return -1;
+    do {
+        while ((seq = self->seq) & 1)
+            __builtin_ia32_pause();
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        out->version = self->version;
+        out->seq = seq;
+        out->generation = self->generation;
+        out->pid = self->pid;
+        out->tid = self->tid;
+        out->cpu = self->cpu;
+        out->node = self->node;
+        out->sum_exec_runtime = self->sum_exec_runtime;
+        out->switch_tsc = self->switch_tsc;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (self->seq != seq);
+    return 0;
+}
+
+/* 以下三个在内核不支持 vtask 时退回对应的系统调用 */
+static inline pid_t vtask_gettid(void)
+{
+    const volatile struct vtask_data *self = vtask_self();
+    return self ? self->tid : (pid_t)syscall(SYS_gettid);
+}
+
+static inline pid_t vtask_getpid(void)
+{
+    const volatile struct vtask_data *self = vtask_self();
+    return self ? self->pid : getpid();
+}
+
+static inline unsigned vtask_getcpu(void)
+{
+    const volatile struct vtask_data *self = vtask_self();
+    return self ? self->cpu : (unsigned)sched_getcpu();
+}
+
+#endif // _VTASK_H
@@ -0,0 +1,112 @@
+/*
+ * xring 与直接系统调用的对比
+ *
+ * 用法: ./bench_xring [-n ops] [-c app_cpu] [-w worker_cpu]
+ *
+ * 对 write_kv / read_kv 分别测:
+ *   syscall        每个请求一次系统调用
+ *   ring/batch=N   每次提交 N 个请求再等结果
+ * worker_cpu 与 app_cpu 相同时 worker 和应用抢同一个核，不同时是
+ * FlexSC 式的专用系统调用核。
+ */
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "xring.h"
+#include "../kv_syscall/kv_syscalls.h"
+
+#define ENTRIES 256
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double bench_syscall(int write, long ops)
+{
+    double t0 = now_ns();
+    for (long i = 0; i < ops; i++) {
+        if (write)
+            write_kv(i & 4095, (int)i);
+        else
+            read_kv(i & 4095);
+    }
+    return (now_ns() - t0) / ops;
+}
+
+static double bench_ring(struct xring *r, int write, long ops, int batch)
+{
+    struct xring_cqe cqe;
+    double t0 = now_ns();
+
+    for (long i = 0; i < ops; i += batch) {
+        for (int j = 0; j < batch; j++) {
+            struct xring_sqe *sqe = xring_get_sqe(r);
+            long k = (i + j) & 4095;
+            if (write)
+                xring_prep(sqe, XRING_OP_WRITE_KV, i + j, k, i + j);
+            else
+                xring_prep(sqe, XRING_OP_READ_KV, i + j, k, 0);
+        }
+        xring_submit(r);
+        xring_wait(r, batch);
+        while (xring_peek_cqe(r, &cqe))
+            ;
+    }
+    return (now_ns() - t0) / ops;
+}
+
+int main(int argc, char **argv)
+{
+    long ops = 1000000;
+    int app_cpu = 0, worker_cpu = -1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:c:w:")) != -1) {
+        switch (opt) {
+        case 'n': ops = atol(optarg); break;
+        case 'c': app_cpu = atoi(optarg); break;
+        case 'w': worker_cpu = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n ops] [-c app_cpu] [-w worker_cpu]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (worker_cpu < 0)
+        worker_cpu = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? app_cpu + 1 : app_cpu;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(app_cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        perror("sched_setaffinity");
+        return 1;
+    }
+
+    struct xring r;
+    if (xring_init(&r, ENTRIES, worker_cpu) != 0) {
+        perror("xring_setup");
+        return 1;
+    }
+
+    static const int batches[] = { 1, 8, 32, 128 };
+    printf("ops=%ld app_cpu=%d worker_cpu=%d\n", ops, app_cpu, worker_cpu);
+    printf("%-10s %-16s %10s\n", "op", "mode", "ns/op");
+    for (int write = 1; write >= 0; write--) {
+        const char *name = write ? "write_kv" : "read_kv";
+        printf("%-10s %-16s %10.1f\n", name, "syscall", bench_syscall(write, ops));
+        for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+            char mode[32];
+            snprintf(mode, sizeof(mode), "ring/batch=%d", batches[b]);
+            printf("%-10s %-16s %10.1f\n", name, mode, bench_ring(&r, write, ops, batches[b]));
+        }
+    }
+
+    xring_exit(&r);
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "xring.h"
+#include "../kv_syscall/kv_syscalls.h"
+
+#define ENTRIES 64
+
+static struct xring_cqe run_one(struct xring *r, uint32_t op, int64_t a0, int64_t a1)
+{
+    static uint64_t seq;
+    struct xring_sqe *sqe = xring_get_sqe(r);
+    struct xring_cqe cqe;
+
+    assert(sqe != NULL);
+    xring_prep(sqe, op, ++seq, a0, a1);
+    assert(xring_submit(r) == 0);
+    assert(xring_wait(r, 1) == 0);
+    assert(xring_peek_cqe(r, &cqe) == 1);
+    assert(cqe.user_data == seq);
+    return cqe;
+}
+
+static void *thread_func(void *arg)
+{
+    struct xring r;
+    int id = (int)(long)arg;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+    // 每个线程自己的 ring，分散到不同 CPU 的 worker 上
+    assert(xring_init(&r, ENTRIES, id % ncpu) == 0);
+    for (int i = 0; i < 1000; i++)
+        assert(run_one(&r, XRING_OP_WRITE_KV, 20000 + id * 1000 + i, i).res == sizeof(int));
+    xring_exit(&r);
+    return NULL;
+}
+
+int main(void)
+{
+    struct xring r;
+    struct xring_cqe cqe;
+
+    printf("Testing xring...\n");
+    assert(xring_init(&r, ENTRIES, -1) == 0);
+    assert(r.hdr->entries == ENTRIES);
+
+    // Test 1: NOP
+    cqe = run_one(&r, XRING_OP_NOP, 0, 0);
+    assert(cqe.res == 0);
+    printf("Test 1 passed: nop\n");
+
+    // Test 2: 通过 ring 写，系统调用读；反过来也一样
+    for (int i = 0; i < 100; i++)
+        assert(run_one(&r, XRING_OP_WRITE_KV, 10000 + i, i * 7).res == sizeof(int));
+    for (int i = 0; i < 100; i++)
+        assert(read_kv(10000 + i) == i * 7);
+    write_kv(10200, 42);
+    assert(run_one(&r, XRING_OP_READ_KV, 10200, 0).res == 42);
+    assert(run_one(&r, XRING_OP_READ_KV, 10999, 0).res == -1);
+    printf("Test 2 passed: write_kv/read_kv through the ring\n");
+
+    // Test 3: 批量提交，完成顺序与提交顺序一致
+    for (int i = 0; i < ENTRIES; i++) {
+        struct xring_sqe *sqe = xring_get_sqe(&r);
+        assert(sqe != NULL);
+        xring_prep(sqe, XRING_OP_WRITE_KV, 1000 + i, 10300 + i, i);
+    }
+    assert(xring_get_sqe(&r) == NULL);     // 队列满
+    assert(xring_submit(&r) == 0);
+    assert(xring_wait(&r, ENTRIES) == 0);
+    for (int i = 0; i < ENTRIES; i++) {
+        assert(xring_peek_cqe(&r, &cqe) == 1);
+        assert(cqe.user_data == (uint64_t)(1000 + i));
+        assert(cqe.res == sizeof(int));
+    }
+    assert(xring_peek_cqe(&r, &cqe) == 0);
+    for (int i = 0; i < ENTRIES; i++)
+        assert(read_kv(10300 + i) == i);
+    printf("Test 3 passed: batch of %d\n", ENTRIES);
+
+    // Test 4: 非法请求
+    assert(run_one(&r, XRING_OP_LAST, 0, 0).res == -EINVAL);
+    {
+        struct xring_sqe *sqe = xring_get_sqe(&r);
+        xring_prep(sqe, XRING_OP_NOP, 7, 0, 0);
+        sqe->flags = 1;
+        assert(xring_submit(&r) == 0);
+        assert(xring_wait(&r, 1) == 0);
+        assert(xring_peek_cqe(&r, &cqe) == 1 && cqe.res == -EINVAL);
+    }
+    printf("Test 4 passed: invalid requests rejected\n");
+
+    // Test 5: worker 空闲后睡眠，提交时被唤醒
+    usleep(20000);
+    assert(r.hdr->flags & XRING_NEED_WAKEUP);
+    assert(run_one(&r, XRING_OP_NOP, 0, 0).res == 0);
+    printf("Test 5 passed: worker sleeps when idle and is woken on submit\n");
+
+    // Test 6: 每个线程只能有一个 ring
+    {
+        struct xring r2;
+        assert(xring_init(&r2, ENTRIES, -1) == -1 && errno == EBUSY);
+    }
+    printf("Test 6 passed: one ring per thread\n");
+
+    // Test 7: 多线程各自的 ring
+    pthread_t threads[8];
+    for (long i = 0; i < 8; i++)
+        pthread_create(&threads[i], NULL, thread_func, (void *)i);
+    for (int i = 0; i < 8; i++)
+        pthread_join(threads[i], NULL);
+    for (int id = 0; id < 8; id++)
+        for (int i = 0; i < 1000; i++)
+            assert(read_kv(20000 + id * 1000 + i) == i);
+    printf("Test 7 passed: per-thread rings\n");
+
+    // Test 8: 注销后不能再 enter
+    xring_exit(&r);
+    assert(syscall(__NR_xring_enter, 0, XRING_ENTER_WAKEUP) == -1 && errno == ENOENT);
+    printf("Test 8 passed: unregister\n");
+
+    printf("All xring tests PASSED!\n");
+    return 0;
+}
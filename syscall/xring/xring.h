@@ -0,0 +1,218 @@
+#ifndef _XRING_H
+#define _XRING_H
+
+/*
+ * 无需陷入的系统调用 (exception-less syscall) 用户态接口
+ *
+ * 线程把请求写进共享内存中的提交队列 (sq)，内核中每个 CPU 一个的 worker
+ * 轮询队列、代为执行，并把结果写进完成队列 (cq)。worker 空闲一段时间后
+ * 睡眠并设置 XRING_NEED_WAKEUP，此时提交者需要调用一次 xring_enter 唤醒它。
+ *
+ * 与内核 include/uapi/linux/xring.h 保持一致。一个 struct xring 只能被
+ * 注册它的那个线程使用。
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef __NR_xring_setup
+#define __NR_xring_setup 456
+#endif
+
+#ifndef __NR_xring_enter
+#define __NR_xring_enter 457
+#endif
+
+#ifndef XRING_NEED_WAKEUP
+enum {
+    XRING_OP_NOP,
+    XRING_OP_WRITE_KV,          /* args: key, value */
+    XRING_OP_READ_KV,           /* args: key */
+    XRING_OP_SOCKET_FAIRNESS,   /* args: thread_id, max_socket_allowed */
+    XRING_OP_LAST,
+};
+
+struct xring_sqe {
+    uint32_t opcode;
+    uint32_t flags;
+    uint64_t user_data;
+    int64_t args[4];
+};
+
+struct xring_cqe {
+    uint64_t user_data;
+    int64_t res;                /* 系统调用返回值, 失败为 -errno */
+};
+
+#define XRING_NEED_WAKEUP   (1U << 0)
+
+/* 每个下标独占一个 cache line */
+struct xring_hdr {
+    uint32_t sq_head;           /* 内核消费 */
+    uint32_t __pad0[15];
+    uint32_t sq_tail;           /* 用户生产 */
+    uint32_t __pad1[15];
+    uint32_t cq_head;           /* 用户消费 */
+    uint32_t __pad2[15];
+    uint32_t cq_tail;           /* 内核生产 */
+    uint32_t flags;
+    uint32_t entries;
+    uint32_t __pad3[13];
+};
+
+#define XRING_SQ_OFF        sizeof(struct xring_hdr)
+#define XRING_CQ_OFF(n)     (XRING_SQ_OFF + (n) * sizeof(struct xring_sqe))
+#define XRING_SIZE(n)       (XRING_CQ_OFF(n) + (n) * sizeof(struct xring_cqe))
+#define XRING_MAX_ENTRIES   4096
+
+struct xring_params {
+    uint32_t entries;
+    uint32_t flags;
+    int32_t cpu;
+    uint32_t resv[5];
+};
+
+#define XRING_SETUP_CPU         (1U << 0)
+#define XRING_UNREGISTER        (1U << 1)
+
+#define XRING_ENTER_WAKEUP      (1U << 0)
+#define XRING_ENTER_GETEVENTS   (1U << 1)
+#endif
+
+struct xring {
+    struct xring_hdr *hdr;
+    struct xring_sqe *sq;
+    struct xring_cqe *cq;
+    uint32_t mask;
+    uint32_t sq_tail;           /* 本地副本, xring_submit 时发布 */
+    void *mem;
+};
+
+/**
+ * @brief 为当前线程创建并注册 ring
+ * @param r 输出
+ * @param entries 队列长度，2 的幂
+ * @param cpu 由哪个 CPU 的 worker 服务，-1 表示当前 CPU
+ * @return 成功返回 0，失败返回 -1 并设置 errno
+ */
+static inline int xring_init(struct xring *r, unsigned int entries, int cpu)
+{
+    struct xring_params p;
+    size_t size = XRING_SIZE(entries);
+    long page = sysconf(_SC_PAGESIZE);
+
+    size = (size + page - 1) & ~(size_t)(page - 1);
+    if (posix_memalign(&r->mem, page, size) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(r->mem, 0, size);
+
+    memset(&p, 0, sizeof(p));
+    p.entries = entries;
+    if (cpu >= 0) {
+        p.flags = XRING_SETUP_CPU;
+        p.cpu = cpu;
+    }
+    if (syscall(__NR_xring_setup, r->mem, &p) != 0) {
+        free(r->mem);
+        return -1;
+    }
+
+    r->hdr = (struct xring_hdr *)r->mem;
+    r->sq = (struct xring_sqe *)((char *)r->mem + XRING_SQ_OFF);
+    r->cq = (struct xring_cqe *)((char *)r->mem + XRING_CQ_OFF(entries));
+    r->mask = entries - 1;
+    r->sq_tail = 0;
+    return 0;
+}
+
+/**
+ * @brief 注销 ring 并释放内存
+ */
+static inline void xring_exit(struct xring *r)
+{
+    struct xring_params p;
+
+    memset(&p, 0, sizeof(p));
+    p.flags = XRING_UNREGISTER;
+    syscall(__NR_xring_setup, NULL, &p);
+    free(r->mem);
+    r->mem = NULL;
+}
+
+/**
+ * @brief 取一个空闲的提交项，队列满时返回 NULL
+ * @note 填好之后需要 xring_submit 才会被内核看到
+ */
+static inline struct xring_sqe *xring_get_sqe(struct xring *r)
+{
+    uint32_t head = __atomic_load_n(&r->hdr->sq_head, __ATOMIC_ACQUIRE);
+    struct xring_sqe *sqe;
+
+    if (r->sq_tail - head > r->mask)
+        return NULL;
+    sqe = &r->sq[r->sq_tail & r->mask];
+    r->sq_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static inline void xring_prep(struct xring_sqe *sqe, uint32_t op, uint64_t user_data,
+                              int64_t a0, int64_t a1)
+{
+    sqe->opcode = op;
+    sqe->user_data = user_data;
+    sqe->args[0] = a0;
+    sqe->args[1] = a1;
+}
+
+/**
+ * @brief 发布已填好的提交项，必要时唤醒睡眠的 worker
+ * @return 成功返回 0，失败返回 -1
+ */
+static inline int xring_submit(struct xring *r)
+{
+    __atomic_store_n(&r->hdr->sq_tail, r->sq_tail, __ATOMIC_RELEASE);
+    // 和 worker 设置 NEED_WAKEUP 之后的 smp_mb 配对
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->hdr->flags, __ATOMIC_RELAXED) & XRING_NEED_WAKEUP)
+        return syscall(__NR_xring_enter, 0, XRING_ENTER_WAKEUP) == 0 ? 0 : -1;
+    return 0;
+}
+
+/**
+ * @brief 取一个完成项 (不阻塞)
+ * @return 有完成项返回 1 并填充 *out，否则返回 0
+ */
+static inline int xring_peek_cqe(struct xring *r, struct xring_cqe *out)
+{
+    uint32_t head = r->hdr->cq_head;
+
+    if (head == __atomic_load_n(&r->hdr->cq_tail, __ATOMIC_ACQUIRE))
+        return 0;
+    *out = r->cq[head & r->mask];
+    __atomic_store_n(&r->hdr->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/**
+ * @brief 等待至少 @n 个完成项，先自旋一会儿再进内核睡眠
+ * @return 成功返回 0，失败返回 -1
+ */
+static inline int xring_wait(struct xring *r, unsigned int n)
+{
+    for (int spin = 0; spin < 4096; spin++) {
+        uint32_t ready = __atomic_load_n(&r->hdr->cq_tail, __ATOMIC_ACQUIRE) - r->hdr->cq_head;
+        if (ready >= n)
+            return 0;
+        __builtin_ia32_pause();
+    }
+    return syscall(__NR_xring_enter, n, XRING_ENTER_GETEVENTS) == 0 ? 0 : -1;
+}
+
+#endif // _XRING_H